@@ -0,0 +1,247 @@
+#include "CaptureFile.h"
+#include <chrono>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+uint64_t NowMillis()
+{
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+static bool ToLocalTime(time_t t, struct tm& out)
+{
+#ifdef _WIN32
+    return localtime_s(&out, &t) == 0;
+#else
+    return localtime_r(&t, &out) != nullptr;
+#endif
+}
+
+FILE* OpenFileUtf8(const std::string& path, const char* mode)
+{
+#ifdef _WIN32
+    wchar_t pathW[MAX_PATH * 2], modeW[8];
+    if (MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, pathW, MAX_PATH * 2) == 0) return nullptr;
+    MultiByteToWideChar(CP_UTF8, 0, mode, -1, modeW, 8);
+    FILE* f = nullptr;
+    if (_wfopen_s(&f, pathW, modeW) != 0) return nullptr;
+    return f;
+#else
+    return fopen(path.c_str(), mode);
+#endif
+}
+
+bool ReplaceFileUtf8(const std::string& from, const std::string& to)
+{
+#ifdef _WIN32
+    wchar_t fromW[MAX_PATH * 2], toW[MAX_PATH * 2];
+    if (MultiByteToWideChar(CP_UTF8, 0, from.c_str(), -1, fromW, MAX_PATH * 2) == 0) return false;
+    if (MultiByteToWideChar(CP_UTF8, 0, to.c_str(), -1, toW, MAX_PATH * 2) == 0) return false;
+    return MoveFileExW(fromW, toW, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+void RemoveFileUtf8(const std::string& path)
+{
+#ifdef _WIN32
+    wchar_t pathW[MAX_PATH * 2];
+    if (MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, pathW, MAX_PATH * 2) != 0) DeleteFileW(pathW);
+#else
+    remove(path.c_str());
+#endif
+}
+
+void TimestampFormatter::Format(uint64_t timeMs, char* out)
+{
+    int64_t second = (int64_t)(timeMs / 1000);
+    if (second != m_cachedSecond) {
+        struct tm tmLocal = {};
+        ToLocalTime((time_t)second, tmLocal);
+        snprintf(m_cachedText, sizeof(m_cachedText), "%04d-%02d-%02d %02d:%02d:%02d",
+            tmLocal.tm_year + 1900, tmLocal.tm_mon + 1, tmLocal.tm_mday,
+            tmLocal.tm_hour, tmLocal.tm_min, tmLocal.tm_sec);
+        m_cachedSecond = second;
+    }
+    unsigned ms = (unsigned)(timeMs % 1000);
+    memcpy(out, m_cachedText, 19);
+    out[19] = '.';
+    out[20] = (char)('0' + ms / 100);
+    out[21] = (char)('0' + (ms / 10) % 10);
+    out[22] = (char)('0' + ms % 10);
+}
+
+std::string TimestampFormatter::Format(uint64_t timeMs)
+{
+    char buf[TIMESTAMP_LEN];
+    Format(timeMs, buf);
+    return std::string(buf, TIMESTAMP_LEN);
+}
+
+static bool ReadDigits(const char* p, int count, int& value)
+{
+    value = 0;
+    for (int i = 0; i < count; i++) {
+        if (p[i] < '0' || p[i] > '9') return false;
+        value = value * 10 + (p[i] - '0');
+    }
+    return true;
+}
+
+bool TimestampParser::Parse(const char* text, size_t len, uint64_t& timeMs)
+{
+    if (len < TIMESTAMP_LEN || text[4] != '-' || text[7] != '-' || text[10] != ' ' ||
+        text[13] != ':' || text[16] != ':' || text[19] != '.') {
+        return false;
+    }
+    int sec, ms;
+    if (!ReadDigits(text + 17, 2, sec) || !ReadDigits(text + 20, 3, ms)) return false;
+    if (m_cachedMinuteSeconds < 0 || memcmp(text, m_cachedMinute, 16) != 0) {
+        int year, mon, day, hour, min;
+        if (!ReadDigits(text, 4, year) || !ReadDigits(text + 5, 2, mon) || !ReadDigits(text + 8, 2, day) ||
+            !ReadDigits(text + 11, 2, hour) || !ReadDigits(text + 14, 2, min)) {
+            return false;
+        }
+        struct tm tmLocal = {};
+        tmLocal.tm_year = year - 1900;
+        tmLocal.tm_mon = mon - 1;
+        tmLocal.tm_mday = day;
+        tmLocal.tm_hour = hour;
+        tmLocal.tm_min = min;
+        tmLocal.tm_isdst = -1;
+        time_t t = mktime(&tmLocal);
+        if (t == (time_t)-1) return false;
+        memcpy(m_cachedMinute, text, 16);
+        m_cachedMinuteSeconds = (int64_t)t;
+    }
+    timeMs = (uint64_t)(m_cachedMinuteSeconds + sec) * 1000 + (uint64_t)ms;
+    return true;
+}
+
+bool CaptureWriter::Open(const std::string& path)
+{
+    Close();
+    m_file = OpenFileUtf8(path, "wb");
+    if (m_file) setvbuf(m_file, nullptr, _IOFBF, 64 * 1024);
+    return m_file != nullptr;
+}
+
+void CaptureWriter::WriteLine(uint64_t timeMs, const char* text, size_t len)
+{
+    if (!m_file) return;
+    while (len > 0 && (text[len - 1] == '\r' || text[len - 1] == '\n')) len--;
+    char stamp[TIMESTAMP_LEN + 1];
+    m_formatter.Format(timeMs, stamp);
+    stamp[TIMESTAMP_LEN] = '\t';
+    fwrite(stamp, 1, sizeof(stamp), m_file);
+    fwrite(text, 1, len, m_file);
+    fputc('\n', m_file);
+}
+
+void CaptureWriter::Append(uint64_t timeMs, const char* data, size_t len)
+{
+    if (!m_file) return;
+    while (len > 0) {
+        const char* nl = (const char*)memchr(data, '\n', len);
+        if (!nl) {
+            if (m_partial.empty()) m_partialTime = timeMs;
+            m_partial.append(data, len);
+            return;
+        }
+        size_t take = (size_t)(nl - data);
+        if (m_partial.empty()) {
+            WriteLine(timeMs, data, take);
+        }
+        else {
+            m_partial.append(data, take);
+            WriteLine(timeMs, m_partial.data(), m_partial.size());
+            m_partial.clear();
+        }
+        data += take + 1;
+        len -= take + 1;
+    }
+}
+
+void CaptureWriter::Close()
+{
+    if (!m_file) return;
+    if (!m_partial.empty()) {
+        WriteLine(m_partialTime, m_partial.data(), m_partial.size());
+        m_partial.clear();
+    }
+    fclose(m_file);
+    m_file = nullptr;
+}
+
+bool CaptureReader::Open(const std::string& path)
+{
+    Close();
+    m_file = OpenFileUtf8(path, "rb");
+    if (!m_file) return false;
+    // 64-bit stat: ftell is a 32-bit long on Windows and fails past 2 GB
+#ifdef _WIN32
+    struct _stat64 st;
+    m_fileSize = _fstat64(_fileno(m_file), &st) == 0 ? (uint64_t)st.st_size : 0;
+#else
+    struct stat st;
+    m_fileSize = fstat(fileno(m_file), &st) == 0 ? (uint64_t)st.st_size : 0;
+#endif
+    m_buf.resize(256 * 1024);
+    m_pos = m_end = 0;
+    m_consumed = 0;
+    m_lastTime = 0;
+    return true;
+}
+
+void CaptureReader::Close()
+{
+    if (m_file) fclose(m_file);
+    m_file = nullptr;
+}
+
+bool CaptureReader::ReadLine(std::string& out)
+{
+    out.clear();
+    for (;;) {
+        if (m_pos == m_end) {
+            m_pos = 0;
+            m_end = m_file ? fread(m_buf.data(), 1, m_buf.size(), m_file) : 0;
+            if (m_end == 0) return !out.empty();
+        }
+        const char* start = m_buf.data() + m_pos;
+        const char* nl = (const char*)memchr(start, '\n', m_end - m_pos);
+        size_t take = nl ? (size_t)(nl - start) : m_end - m_pos;
+        out.append(start, take);
+        m_pos += take;
+        m_consumed += take;
+        if (nl) {
+            m_pos++;
+            m_consumed++;
+            if (!out.empty() && out.back() == '\r') out.pop_back();
+            return true;
+        }
+    }
+}
+
+bool CaptureReader::Next(CaptureLine& line)
+{
+    if (!ReadLine(m_raw)) return false;
+    uint64_t t;
+    m_lastTimed = m_raw.size() > TIMESTAMP_LEN && m_raw[TIMESTAMP_LEN] == '\t' && m_parser.Parse(m_raw.data(), m_raw.size(), t);
+    if (m_lastTimed) {
+        m_lastTime = t;
+        line.timeMs = t;
+        line.text.assign(m_raw, TIMESTAMP_LEN + 1, std::string::npos);
+    }
+    else {
+        line.timeMs = m_lastTime;
+        line.text.swap(m_raw);
+    }
+    return true;
+}
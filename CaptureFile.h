@@ -0,0 +1,88 @@
+// CaptureFile.h : timestamped line files written by trigger captures and read by export/merge
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// Milliseconds since the Unix epoch (UTC).
+uint64_t NowMillis();
+
+// Formats/parses "YYYY-MM-DD HH:MM:SS.mmm" in local time. Both cache the
+// last second/minute seen, so per-line cost on sorted input is a few copies.
+class TimestampFormatter {
+public:
+    // Writes exactly TIMESTAMP_LEN characters to out.
+    void Format(uint64_t timeMs, char* out);
+    std::string Format(uint64_t timeMs);
+private:
+    int64_t m_cachedSecond = -1;
+    char m_cachedText[64] = {};
+};
+
+class TimestampParser {
+public:
+    bool Parse(const char* text, size_t len, uint64_t& timeMs);
+private:
+    char m_cachedMinute[16] = {};
+    int64_t m_cachedMinuteSeconds = -1;
+};
+
+#define TIMESTAMP_LEN 23
+
+// One record of a capture file: "<timestamp>\t<text>\n"
+struct CaptureLine {
+    uint64_t timeMs = 0;
+    std::string text;
+};
+
+// Splits raw chunks into lines and appends them as capture records. A line is
+// stamped with the receive time of the chunk that completed it.
+class CaptureWriter {
+public:
+    ~CaptureWriter() { Close(); }
+    bool Open(const std::string& path);
+    bool IsOpen() const { return m_file != nullptr; }
+    void Append(uint64_t timeMs, const char* data, size_t len);
+    void WriteLine(uint64_t timeMs, const char* text, size_t len);
+    // Flushes any partial line and closes the file.
+    void Close();
+private:
+    FILE* m_file = nullptr;
+    std::string m_partial;
+    uint64_t m_partialTime = 0;
+    TimestampFormatter m_formatter;
+};
+
+// Streams records back out of a capture file with a fixed-size read buffer.
+class CaptureReader {
+public:
+    ~CaptureReader() { Close(); }
+    bool Open(const std::string& path);
+    void Close();
+    // Returns false at end of file. Lines without a valid timestamp inherit
+    // the previous record's time so hand-edited files still merge sensibly.
+    bool Next(CaptureLine& line);
+    // Whether the record last returned by Next carried its own timestamp.
+    bool LastTimed() const { return m_lastTimed; }
+    uint64_t BytesRead() const { return m_consumed; }
+    uint64_t FileSize() const { return m_fileSize; }
+private:
+    bool ReadLine(std::string& out);
+    FILE* m_file = nullptr;
+    std::vector<char> m_buf;
+    size_t m_pos = 0, m_end = 0;
+    uint64_t m_consumed = 0, m_fileSize = 0, m_lastTime = 0;
+    bool m_lastTimed = false;
+    std::string m_raw;
+    TimestampParser m_parser;
+};
+
+// Opens a file with a UTF-8 path (converted to UTF-16 on Windows).
+FILE* OpenFileUtf8(const std::string& path, const char* mode);
+// Renames from over to, replacing an existing file.
+bool ReplaceFileUtf8(const std::string& from, const std::string& to);
+void RemoveFileUtf8(const std::string& path);
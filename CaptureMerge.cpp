@@ -0,0 +1,265 @@
+#include "SocketCompat.h"
+#include "CaptureMerge.h"
+#include <chrono>
+#include <string.h>
+#include <thread>
+
+// --- FileMergeSource ---
+
+bool FileMergeSource::Open(const std::string& path, std::string& error)
+{
+    if (!m_reader.Open(path)) {
+        error = "cannot open " + path;
+        return false;
+    }
+    m_hasFirst = m_reader.Next(m_first);
+    if (m_hasFirst && !m_reader.LastTimed()) {
+        error = path + " has no timestamps (raw logs cannot be merged; use capture files)";
+        m_reader.Close();
+        return false;
+    }
+    return true;
+}
+
+int FileMergeSource::Poll(CaptureLine& line)
+{
+    if (m_hasFirst) {
+        m_hasFirst = false;
+        line.timeMs = m_first.timeMs;
+        line.text.swap(m_first.text);
+        return 1;
+    }
+    return m_reader.Next(line) ? 1 : -1;
+}
+
+// --- SocketMergeSource ---
+
+SocketMergeSource::~SocketMergeSource()
+{
+    if (m_sock != ~(uintptr_t)0) closesocket((SOCKET)m_sock);
+    if (m_started) SocketsCleanup();
+}
+
+bool SocketMergeSource::Connect(uint16_t port, std::string& error)
+{
+    if (!SocketsStartup()) { error = "WSAStartup failed"; return false; }
+    m_started = true;
+    SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (s == INVALID_SOCKET || connect(s, (sockaddr*)&addr, sizeof(addr)) != 0 || !SetNonBlocking(s)) {
+        if (s != INVALID_SOCKET) closesocket(s);
+        error = "cannot connect to 127.0.0.1:" + std::to_string(port);
+        return false;
+    }
+    m_sock = (uintptr_t)s;
+    return true;
+}
+
+int SocketMergeSource::Poll(CaptureLine& line)
+{
+    for (;;) {
+        size_t nl = m_buf.find('\n', m_pos);
+        if (nl != std::string::npos) {
+            size_t len = nl - m_pos;
+            const char* p = m_buf.data() + m_pos;
+            if (len > 0 && p[len - 1] == '\r') len--;
+            uint64_t t;
+            if (len > TIMESTAMP_LEN && p[TIMESTAMP_LEN] == '\t' && m_parser.Parse(p, len, t)) {
+                m_lastTime = t;
+                line.text.assign(p + TIMESTAMP_LEN + 1, len - TIMESTAMP_LEN - 1);
+            }
+            else {
+                line.text.assign(p, len);
+            }
+            line.timeMs = m_lastTime;
+            m_pos = nl + 1;
+            return 1;
+        }
+        if (m_sock == ~(uintptr_t)0) return -1;
+        m_buf.erase(0, m_pos);
+        m_pos = 0;
+        char buf[16 * 1024];
+        int n = recv((SOCKET)m_sock, buf, sizeof(buf), 0);
+        if (n > 0) {
+            m_buf.append(buf, n);
+            continue;
+        }
+        if (n < 0 && SOCKET_WOULD_BLOCK()) return 0;
+        closesocket((SOCKET)m_sock);
+        m_sock = ~(uintptr_t)0;
+        if (!m_buf.empty()) m_buf.push_back('\n');
+    }
+}
+
+// --- CaptureMerger ---
+
+void CaptureMerger::AddSource(std::unique_ptr<MergeSource> source, const std::string& label)
+{
+    Slot slot;
+    slot.source = std::move(source);
+    slot.label = label;
+    m_sources.push_back(std::move(slot));
+}
+
+// Ties go to the lower input index so equal timestamps keep a stable order.
+bool CaptureMerger::Before(size_t a, size_t b) const
+{
+    uint64_t ta = m_sources[a].pending.timeMs, tb = m_sources[b].pending.timeMs;
+    return ta != tb ? ta < tb : a < b;
+}
+
+void CaptureMerger::Push(size_t slot)
+{
+    m_heap.push_back(slot);
+    size_t i = m_heap.size() - 1;
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!Before(m_heap[i], m_heap[parent])) break;
+        std::swap(m_heap[i], m_heap[parent]);
+        i = parent;
+    }
+}
+
+size_t CaptureMerger::Pop()
+{
+    size_t top = m_heap[0];
+    m_heap[0] = m_heap.back();
+    m_heap.pop_back();
+    size_t i = 0, n = m_heap.size();
+    for (;;) {
+        size_t l = 2 * i + 1, r = l + 1, best = i;
+        if (l < n && Before(m_heap[l], m_heap[best])) best = l;
+        if (r < n && Before(m_heap[r], m_heap[best])) best = r;
+        if (best == i) break;
+        std::swap(m_heap[i], m_heap[best]);
+        i = best;
+    }
+    return top;
+}
+
+int CaptureMerger::Next(MergedLine& out, uint64_t nowMs)
+{
+    // Refill every input that has no queued line; only a live input can stay empty
+    bool waiting = false;
+    for (size_t i = 0; i < m_sources.size(); i++) {
+        Slot& slot = m_sources[i];
+        if (slot.hasPending || slot.ended) continue;
+        int r = slot.source->Poll(slot.pending);
+        if (r > 0) { slot.hasPending = true; Push(i); }
+        else if (r < 0) slot.ended = true;
+        else waiting = true;
+    }
+    if (m_heap.empty()) return waiting ? 0 : -1;
+    size_t top = m_heap[0];
+    if (waiting && m_sources[top].pending.timeMs + liveLagMs > nowMs) return 0;
+    Pop();
+    Slot& slot = m_sources[top];
+    out.timeMs = slot.pending.timeMs;
+    out.source = top;
+    out.text.swap(slot.pending.text);
+    slot.hasPending = false;
+    return 1;
+}
+
+double CaptureMerger::Progress() const
+{
+    if (m_sources.empty()) return 1.0;
+    double sum = 0;
+    for (const Slot& slot : m_sources) sum += slot.ended ? 1.0 : slot.source->Progress();
+    return sum / m_sources.size();
+}
+
+std::string MergeLabelForPath(const std::string& path)
+{
+    size_t slash = path.find_last_of("\\/");
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    for (const char* prefix : { "capture_", "log_" }) {
+        size_t len = strlen(prefix);
+        if (name.compare(0, len, prefix) == 0) {
+            size_t end = name.find('_', len);
+            if (end != std::string::npos) return name.substr(len, end - len);
+        }
+    }
+    size_t dot = name.find_last_of('.');
+    return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+// --- RunMerge ---
+
+bool RunMerge(const MergeRequest& request, MergeStatus& status)
+{
+    status.permille = 0;
+    status.rows = 0;
+    status.error.clear();
+    status.labels.clear();
+    status.tail.clear();
+
+    CaptureMerger merger;
+    for (const std::string& input : request.inputs) {
+        if (input.compare(0, 4, "tcp:") == 0) {
+            std::unique_ptr<SocketMergeSource> source(new SocketMergeSource());
+            if (!source->Connect((uint16_t)atoi(input.c_str() + 4), status.error)) return false;
+            merger.AddSource(std::move(source), input);
+        }
+        else {
+            std::unique_ptr<FileMergeSource> source(new FileMergeSource());
+            if (!source->Open(input, status.error)) return false;
+            merger.AddSource(std::move(source), MergeLabelForPath(input));
+        }
+        status.labels.push_back(merger.Label(merger.SourceCount() - 1));
+    }
+
+    bool toStdout = request.outputPath.empty() || request.outputPath == "-";
+    FILE* f = toStdout ? stdout : OpenFileUtf8(request.outputPath, "wb");
+    if (!f) { status.error = "cannot create " + request.outputPath; return false; }
+
+    static const char* colors[] = { "\x1b[32m", "\x1b[36m", "\x1b[33m", "\x1b[35m", "\x1b[34m", "\x1b[31m" };
+    std::vector<std::string> prefixes;
+    for (size_t i = 0; i < merger.SourceCount(); i++) {
+        std::string label = "[" + merger.Label(i) + "] ";
+        prefixes.push_back(request.color && toStdout ? colors[i % 6] + label + "\x1b[0m" : label);
+    }
+
+    TimestampFormatter formatter;
+    char stamp[TIMESTAMP_LEN + 1];
+    stamp[TIMESTAMP_LEN] = '\t';
+    std::string out;
+    MergedLine line;
+    uint64_t rows = 0;
+    bool ok = true;
+    for (;;) {
+        int r = merger.Next(line, NowMillis());
+        if (r < 0) break;
+        if (r == 0) {
+            // Live inputs are idle: hand out what we have and wait a little
+            if (!out.empty()) { fwrite(out.data(), 1, out.size(), f); out.clear(); fflush(f); }
+            if (status.cancel) { status.error = "cancelled"; ok = false; break; }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        formatter.Format(line.timeMs, stamp);
+        out.append(stamp, sizeof(stamp));
+        out += prefixes[line.source];
+        out += line.text;
+        out.push_back('\n');
+        if (out.size() >= 1024 * 1024) { fwrite(out.data(), 1, out.size(), f); out.clear(); }
+        if (request.keepTail) {
+            status.tail.push_back(line);
+            if (status.tail.size() > request.keepTail) status.tail.pop_front();
+        }
+        if ((++rows & 0xFFF) == 0) {
+            status.rows = rows;
+            status.permille = (int)(merger.Progress() * 1000);
+            if (status.cancel) { status.error = "cancelled"; ok = false; break; }
+        }
+    }
+    if (!out.empty()) fwrite(out.data(), 1, out.size(), f);
+    if (toStdout) fflush(f);
+    else if (fclose(f) != 0 && ok) { status.error = "write failed"; ok = false; }
+    status.rows = rows;
+    if (ok) status.permille = 1000;
+    return ok;
+}
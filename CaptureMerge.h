@@ -0,0 +1,111 @@
+// CaptureMerge.h : time-aligned k-way merge of several port captures
+//
+
+#pragma once
+
+#include "CaptureFile.h"
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+// One input of a merge. Poll returns 1 with a line, 0 when a live input has
+// nothing yet, and -1 once the input is exhausted or disconnected.
+class MergeSource {
+public:
+    virtual ~MergeSource() {}
+    virtual int Poll(CaptureLine& line) = 0;
+    virtual bool Live() const { return false; }
+    virtual double Progress() const { return 0; }
+};
+
+// Capture file (or any "timestamp<TAB>text" file), streamed. Files whose
+// first line has no timestamp, such as raw log_ files, are refused: all of
+// their lines would sort to the same instant.
+class FileMergeSource : public MergeSource {
+public:
+    bool Open(const std::string& path, std::string& error);
+    int Poll(CaptureLine& line) override;
+    double Progress() const override
+    {
+        return m_reader.FileSize() ? (double)m_reader.BytesRead() / (double)m_reader.FileSize() : 1.0;
+    }
+private:
+    CaptureReader m_reader;
+    CaptureLine m_first;
+    bool m_hasFirst = false;
+};
+
+// "lines" stream of another monitor's Share server on this machine.
+class SocketMergeSource : public MergeSource {
+public:
+    ~SocketMergeSource() override;
+    bool Connect(uint16_t port, std::string& error);
+    int Poll(CaptureLine& line) override;
+    bool Live() const override { return true; }
+private:
+    uintptr_t m_sock = ~(uintptr_t)0;
+    bool m_started = false;
+    std::string m_buf;
+    size_t m_pos = 0;
+    TimestampParser m_parser;
+    uint64_t m_lastTime = 0;
+};
+
+struct MergedLine {
+    uint64_t timeMs = 0;
+    size_t source = 0;
+    std::string text;
+};
+
+// Keeps exactly one pending line per input in a min-heap, so memory does not
+// grow with input size. With live inputs a line is released once every input
+// has something queued or it is older than liveLagMs.
+class CaptureMerger {
+public:
+    void AddSource(std::unique_ptr<MergeSource> source, const std::string& label);
+    size_t SourceCount() const { return m_sources.size(); }
+    const std::string& Label(size_t source) const { return m_sources[source].label; }
+    // 1 = line returned, 0 = waiting on a live input, -1 = every input finished.
+    int Next(MergedLine& out, uint64_t nowMs);
+    double Progress() const;
+    uint32_t liveLagMs = 500;
+private:
+    struct Slot {
+        std::unique_ptr<MergeSource> source;
+        std::string label;
+        CaptureLine pending;
+        bool hasPending = false;
+        bool ended = false;
+    };
+    bool Before(size_t a, size_t b) const;
+    void Push(size_t slot);
+    size_t Pop();
+    std::vector<Slot> m_sources;
+    std::vector<size_t> m_heap;
+};
+
+// "capture_COM3_..." / "log_COM3_..." -> "COM3", otherwise the file stem.
+std::string MergeLabelForPath(const std::string& path);
+
+struct MergeRequest {
+    std::vector<std::string> inputs;   // file paths, or "tcp:<port>" for a live lines stream
+    std::string outputPath;            // empty or "-" writes to stdout
+    bool color = false;                // ANSI colour per input on stdout
+    size_t keepTail = 0;               // remember the newest N merged lines for display
+};
+
+struct MergeStatus {
+    std::atomic<int> permille{ 0 };
+    std::atomic<uint64_t> rows{ 0 };
+    std::atomic<bool> cancel{ false };
+    std::string error;
+    std::vector<std::string> labels;
+    std::deque<MergedLine> tail;
+};
+
+// Merged records are written as "timestamp<TAB>[label] text", which is itself
+// a capture file and can be exported or merged again.
+bool RunMerge(const MergeRequest& request, MergeStatus& status);
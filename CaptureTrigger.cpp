@@ -0,0 +1,327 @@
+#include "CaptureTrigger.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static std::string Trim(const std::string& s)
+{
+    size_t first = s.find_first_not_of(" \t");
+    if (first == std::string::npos) return std::string();
+    size_t last = s.find_last_not_of(" \t");
+    return s.substr(first, last - first + 1);
+}
+
+static bool ParseNumber(const std::string& s, double& value)
+{
+    if (s.empty()) return false;
+    char* end = nullptr;
+    value = strtod(s.c_str(), &end);
+    return end != s.c_str() && value >= 0;
+}
+
+// "250ms" or "5" (seconds) -> milliseconds
+static bool ParseDurationMs(const std::string& s, bool defaultSeconds, uint32_t& ms)
+{
+    double v;
+    std::string num = s;
+    bool isMs = !defaultSeconds;
+    if (num.size() > 2 && num.compare(num.size() - 2, 2, "ms") == 0) { num.resize(num.size() - 2); isMs = true; }
+    else if (num.size() > 1 && num.back() == 's') { num.pop_back(); isMs = false; }
+    if (!ParseNumber(Trim(num), v)) return false;
+    ms = (uint32_t)(isMs ? v : v * 1000.0);
+    return true;
+}
+
+static bool ParseSize(const std::string& s, size_t& bytes)
+{
+    double v;
+    std::string num = s;
+    double scale = 1;
+    if (!num.empty() && (num.back() == 'K' || num.back() == 'k')) { scale = 1024; num.pop_back(); }
+    else if (!num.empty() && (num.back() == 'M' || num.back() == 'm')) { scale = 1024 * 1024; num.pop_back(); }
+    if (!ParseNumber(Trim(num), v)) return false;
+    bytes = (size_t)(v * scale);
+    return true;
+}
+
+static bool ParseHexBytes(const std::string& s, std::string& out)
+{
+    out.clear();
+    int nibbles = 0, value = 0;
+    for (char c : s) {
+        int d;
+        if (c >= '0' && c <= '9') d = c - '0';
+        else if (c >= 'a' && c <= 'f') d = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') d = c - 'A' + 10;
+        else if (c == ' ' || c == ',' || c == '-') continue;
+        else return false;
+        value = value * 16 + d;
+        if (++nibbles == 2) { out.push_back((char)value); nibbles = value = 0; }
+    }
+    return nibbles == 0 && !out.empty();
+}
+
+bool ParseTriggerSpec(const std::string& spec, TriggerConfig& config, std::string& error)
+{
+    config = TriggerConfig();
+    size_t start = 0;
+    while (start <= spec.size()) {
+        size_t end = spec.find(';', start);
+        if (end == std::string::npos) end = spec.size();
+        std::string entry = Trim(spec.substr(start, end - start));
+        start = end + 1;
+        if (entry.empty()) continue;
+        size_t colon = entry.find(':');
+        if (colon == std::string::npos) { error = "missing ':' in \"" + entry + "\""; return false; }
+        std::string key = Trim(entry.substr(0, colon));
+        std::string value = entry.substr(colon + 1);
+        bool ok = true;
+        if (key == "text") {
+            ok = !value.empty();
+            config.patterns.push_back(value);
+            config.names.push_back("\"" + value + "\"");
+        }
+        else if (key == "bytes") {
+            std::string bytes;
+            ok = ParseHexBytes(value, bytes);
+            config.patterns.push_back(bytes);
+            config.names.push_back("bytes " + Trim(value));
+        }
+        else if (key == "silence") ok = ParseDurationMs(Trim(value), false, config.silenceMs) && config.silenceMs > 0;
+        else if (key == "rate") {
+            size_t rate;
+            ok = ParseSize(Trim(value), rate) && rate > 0;
+            config.rateBytesPerSec = (uint32_t)rate;
+        }
+        else if (key == "pre") ok = ParseDurationMs(Trim(value), true, config.preMs);
+        else if (key == "post") ok = ParseDurationMs(Trim(value), true, config.postMs);
+        else if (key == "ring") ok = ParseSize(Trim(value), config.ringBytes) && config.ringBytes >= 4096 && config.ringBytes <= 256u * 1024 * 1024;
+        else { error = "unknown trigger \"" + key + "\""; return false; }
+        if (!ok) { error = "bad value for \"" + key + "\""; return false; }
+    }
+    return true;
+}
+
+void RawRing::Reset(size_t capacity)
+{
+    m_buf.assign(capacity, 0);
+    m_head = m_used = 0;
+}
+
+void RawRing::Write(size_t at, const void* src, size_t len)
+{
+    size_t first = m_buf.size() - at;
+    if (first >= len) { memcpy(&m_buf[at], src, len); return; }
+    memcpy(&m_buf[at], src, first);
+    memcpy(&m_buf[0], (const char*)src + first, len - first);
+}
+
+void RawRing::Read(size_t at, void* dst, size_t len) const
+{
+    size_t first = m_buf.size() - at;
+    if (first >= len) { memcpy(dst, &m_buf[at], len); return; }
+    memcpy(dst, &m_buf[at], first);
+    memcpy((char*)dst + first, &m_buf[0], len - first);
+}
+
+void RawRing::DropOldest()
+{
+    uint32_t len;
+    Read((m_head + 8) % m_buf.size(), &len, 4);
+    m_head = (m_head + HEADER + len) % m_buf.size();
+    m_used -= HEADER + len;
+}
+
+void RawRing::Push(uint64_t timeMs, const char* data, size_t len)
+{
+    if (m_buf.size() <= HEADER) return;
+    if (len > m_buf.size() - HEADER) {
+        data += len - (m_buf.size() - HEADER);
+        len = m_buf.size() - HEADER;
+    }
+    while (m_buf.size() - m_used < HEADER + len) DropOldest();
+    size_t at = (m_head + m_used) % m_buf.size();
+    uint32_t len32 = (uint32_t)len;
+    Write(at, &timeMs, 8);
+    Write((at + 8) % m_buf.size(), &len32, 4);
+    Write((at + HEADER) % m_buf.size(), data, len);
+    m_used += HEADER + len;
+}
+
+void PatternMatcher::Build(const std::vector<std::string>& patterns)
+{
+    m_next.assign(256, -1);
+    m_out.assign(1, -1);
+    m_state = 0;
+    for (size_t p = 0; p < patterns.size(); p++) {
+        int32_t s = 0;
+        for (unsigned char c : patterns[p]) {
+            if (m_next[s * 256 + c] < 0) {
+                m_next[s * 256 + c] = (int32_t)m_out.size();
+                m_out.push_back(-1);
+                m_next.resize(m_next.size() + 256, -1);
+            }
+            s = m_next[s * 256 + c];
+        }
+        if (m_out[s] < 0) m_out[s] = (int32_t)p;
+    }
+    if (patterns.empty()) { m_out.clear(); return; }
+
+    // Breadth-first pass turns the trie into a full automaton: missing edges
+    // follow the failure link, outputs inherit the failure state's match.
+    std::vector<int32_t> fail(m_out.size(), 0), queue;
+    for (int c = 0; c < 256; c++) {
+        int32_t t = m_next[c];
+        if (t < 0) m_next[c] = 0;
+        else { fail[t] = 0; queue.push_back(t); }
+    }
+    for (size_t qi = 0; qi < queue.size(); qi++) {
+        int32_t s = queue[qi];
+        if (m_out[s] < 0) m_out[s] = m_out[fail[s]];
+        for (int c = 0; c < 256; c++) {
+            int32_t t = m_next[s * 256 + c];
+            if (t < 0) {
+                m_next[s * 256 + c] = m_next[fail[s] * 256 + c];
+            }
+            else {
+                fail[t] = m_next[fail[s] * 256 + c];
+                queue.push_back(t);
+            }
+        }
+    }
+}
+
+int PatternMatcher::Feed(const unsigned char* data, size_t len)
+{
+    if (m_out.empty()) return -1;
+    int found = -1;
+    const int32_t* next = m_next.data();
+    const int32_t* out = m_out.data();
+    int32_t s = m_state;
+    for (size_t i = 0; i < len; i++) {
+        s = next[s * 256 + data[i]];
+        if (out[s] >= 0 && found < 0) found = out[s];
+    }
+    m_state = s;
+    return found;
+}
+
+void TriggerCapture::Configure(const TriggerConfig& config, const std::string& pathPrefix)
+{
+    Close();
+    m_config = config;
+    m_pathPrefix = pathPrefix;
+    m_enabled = !config.Empty();
+    m_ring.Reset(m_enabled ? config.ringBytes : 0);
+    m_matcher.Build(config.patterns);
+    m_lastDataMs = 0;
+    m_silenceFired = false;
+    memset(m_buckets, 0, sizeof(m_buckets));
+    m_bucketEpoch = 0;
+    m_rateArmed = true;
+}
+
+void TriggerCapture::UpdateRate(uint64_t nowMs, size_t len)
+{
+    uint64_t epoch = nowMs / 100;
+    if (epoch != m_bucketEpoch) {
+        uint64_t gap = epoch - m_bucketEpoch;
+        for (uint64_t i = 1; i <= gap && i <= 10; i++) m_buckets[(m_bucketEpoch + i) % 10] = 0;
+        m_bucketEpoch = epoch;
+    }
+    m_buckets[epoch % 10] += (uint32_t)len;
+}
+
+void TriggerCapture::Fire(uint64_t nowMs, const std::string& reason)
+{
+    if (m_writer.IsOpen()) {
+        if (nowMs + m_config.postMs > m_postEndMs) m_postEndMs = nowMs + m_config.postMs;
+        m_events.push_back("Trigger " + reason + " (extending capture)");
+        return;
+    }
+    time_t t = (time_t)(nowMs / 1000);
+    struct tm tmLocal = {};
+#ifdef _WIN32
+    localtime_s(&tmLocal, &t);
+#else
+    localtime_r(&t, &tmLocal);
+#endif
+    char stamp[64];
+    snprintf(stamp, sizeof(stamp), "_%04d-%02d-%02d_%02d-%02d-%02d-%03u", tmLocal.tm_year + 1900, tmLocal.tm_mon + 1,
+        tmLocal.tm_mday, tmLocal.tm_hour, tmLocal.tm_min, tmLocal.tm_sec, (unsigned)(nowMs % 1000));
+    m_currentPath = m_pathPrefix + stamp + ".txt";
+    if (!m_writer.Open(m_currentPath)) {
+        m_events.push_back("Trigger " + reason + ": cannot create " + m_currentPath);
+        return;
+    }
+    uint64_t since = nowMs > m_config.preMs ? nowMs - m_config.preMs : 0;
+    m_ring.ForEachSince(since, [this](uint64_t timeMs, const char* data, size_t len) {
+        m_writer.Append(timeMs, data, len);
+    });
+    m_postEndMs = nowMs + m_config.postMs;
+    m_events.push_back("Trigger " + reason + ": capturing");
+}
+
+void TriggerCapture::OnData(uint64_t nowMs, const char* data, size_t len)
+{
+    if (!m_enabled || len == 0) return;
+    bool gapEnded = m_config.silenceMs && m_lastDataMs && !m_silenceFired && nowMs - m_lastDataMs >= m_config.silenceMs;
+    m_lastDataMs = nowMs;
+    m_silenceFired = false;
+
+    m_ring.Push(nowMs, data, len);
+    // A chunk that arrives after the post window belongs to the next capture, not this one
+    EndWindowIfDue(nowMs);
+    if (m_writer.IsOpen()) m_writer.Append(nowMs, data, len);
+
+    if (gapEnded) Fire(nowMs, "silence");
+    int hit = m_matcher.Feed((const unsigned char*)data, len);
+    if (hit >= 0) Fire(nowMs, m_config.names[hit]);
+    if (m_config.rateBytesPerSec) {
+        UpdateRate(nowMs, len);
+        uint64_t total = 0;
+        for (uint32_t b : m_buckets) total += b;
+        if (m_rateArmed && total > m_config.rateBytesPerSec) {
+            m_rateArmed = false;
+            Fire(nowMs, "rate");
+        }
+        else if (total < m_config.rateBytesPerSec / 2) {
+            m_rateArmed = true;
+        }
+    }
+    OnIdle(nowMs);
+}
+
+void TriggerCapture::OnIdle(uint64_t nowMs)
+{
+    if (!m_enabled) return;
+    if (m_config.silenceMs && m_lastDataMs && !m_silenceFired && nowMs - m_lastDataMs >= m_config.silenceMs) {
+        m_silenceFired = true;
+        Fire(nowMs, "silence");
+    }
+    EndWindowIfDue(nowMs);
+}
+
+void TriggerCapture::EndWindowIfDue(uint64_t nowMs)
+{
+    if (m_writer.IsOpen() && nowMs >= m_postEndMs) {
+        m_writer.Close();
+        m_events.push_back("Capture saved: " + m_currentPath);
+    }
+}
+
+void TriggerCapture::Close()
+{
+    if (m_writer.IsOpen()) {
+        m_writer.Close();
+        m_events.push_back("Capture saved: " + m_currentPath);
+    }
+}
+
+bool TriggerCapture::TakeEvent(std::string& message)
+{
+    if (m_events.empty()) return false;
+    message = m_events.front();
+    m_events.erase(m_events.begin());
+    return true;
+}
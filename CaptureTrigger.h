@@ -0,0 +1,113 @@
+// CaptureTrigger.h : trigger-based capture windows over a bounded raw ring buffer
+//
+
+#pragma once
+
+#include "CaptureFile.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Parsed form of the "Triggers" setting, e.g.
+//   text:WATCHDOG RESET; bytes:DE AD BE EF; silence:500; rate:20000; pre:5; post:10; ring:2M
+struct TriggerConfig {
+    std::vector<std::string> patterns;  // text: and bytes: entries, matched on the raw stream
+    std::vector<std::string> names;     // display name per pattern
+    uint32_t silenceMs = 0;             // fire after a gap of at least this long
+    uint32_t rateBytesPerSec = 0;       // fire when the last second exceeds this
+    uint32_t preMs = 5000;
+    uint32_t postMs = 10000;
+    size_t ringBytes = 1024 * 1024;
+    bool Empty() const { return patterns.empty() && silenceMs == 0 && rateBytesPerSec == 0; }
+};
+
+// Returns false and fills error for malformed entries. Spec is UTF-8.
+bool ParseTriggerSpec(const std::string& spec, TriggerConfig& config, std::string& error);
+
+// Fixed-capacity ring of timestamped raw chunks. Records are stored inline as
+// [u64 time][u32 len][bytes], so memory never exceeds the configured capacity.
+class RawRing {
+public:
+    void Reset(size_t capacity);
+    void Push(uint64_t timeMs, const char* data, size_t len);
+    // Calls fn(timeMs, data, len) for every chunk received at or after sinceMs, oldest first.
+    template <class Fn> void ForEachSince(uint64_t sinceMs, Fn fn);
+    size_t Used() const { return m_used; }
+private:
+    static const size_t HEADER = 12;
+    void Write(size_t at, const void* src, size_t len);
+    void Read(size_t at, void* dst, size_t len) const;
+    void DropOldest();
+    std::vector<char> m_buf;
+    size_t m_head = 0;   // offset of oldest record
+    size_t m_used = 0;
+    std::string m_scratch;
+};
+
+// Multi-pattern byte matcher (Aho-Corasick, dense transitions). State carries
+// across Feed calls so patterns split over read boundaries still match.
+class PatternMatcher {
+public:
+    void Build(const std::vector<std::string>& patterns);
+    bool Empty() const { return m_out.empty(); }
+    // Returns the index of the first pattern completed inside data, or -1.
+    int Feed(const unsigned char* data, size_t len);
+private:
+    std::vector<int32_t> m_next;  // state * 256 + byte
+    std::vector<int32_t> m_out;   // shortest pattern ending at state (via fail links), or -1
+    int32_t m_state = 0;
+};
+
+// Runs the triggers over the capture stream and writes the pre/post window of
+// each firing to its own capture file. Called from the capture thread only.
+class TriggerCapture {
+public:
+    // pathPrefix is the log folder plus a per-port stem, e.g. "C:\logs\capture_COM3".
+    void Configure(const TriggerConfig& config, const std::string& pathPrefix);
+    bool Enabled() const { return m_enabled; }
+    void OnData(uint64_t nowMs, const char* data, size_t len);
+    // Call regularly while the port is quiet (the reader's read timeout), so
+    // silence triggers fire and post windows end without further data.
+    void OnIdle(uint64_t nowMs);
+    void Close();
+    // Pops the next human-readable event (capture opened/closed), if any.
+    bool TakeEvent(std::string& message);
+private:
+    void Fire(uint64_t nowMs, const std::string& reason);
+    void UpdateRate(uint64_t nowMs, size_t len);
+    void EndWindowIfDue(uint64_t nowMs);
+    TriggerConfig m_config;
+    std::string m_pathPrefix;
+    bool m_enabled = false;
+    RawRing m_ring;
+    PatternMatcher m_matcher;
+    CaptureWriter m_writer;
+    std::string m_currentPath;
+    uint64_t m_postEndMs = 0;
+    uint64_t m_lastDataMs = 0;
+    bool m_silenceFired = false;
+    // Rate trigger: 10 x 100 ms buckets covering the last second.
+    uint32_t m_buckets[10] = {};
+    uint64_t m_bucketEpoch = 0;
+    bool m_rateArmed = true;
+    std::vector<std::string> m_events;
+};
+
+template <class Fn> void RawRing::ForEachSince(uint64_t sinceMs, Fn fn)
+{
+    size_t at = m_head, left = m_used;
+    while (left >= HEADER) {
+        uint64_t t;
+        uint32_t len;
+        Read(at, &t, 8);
+        Read((at + 8) % m_buf.size(), &len, 4);
+        size_t body = (at + HEADER) % m_buf.size();
+        if (t >= sinceMs) {
+            m_scratch.resize(len);
+            Read(body, &m_scratch[0], len);
+            fn(t, m_scratch.data(), (size_t)len);
+        }
+        at = (body + len) % m_buf.size();
+        left -= HEADER + len;
+    }
+}
@@ -0,0 +1,304 @@
+#include "Exporter.h"
+#include <string.h>
+#include <unordered_map>
+
+// Buffered output so per-row formatting never touches stdio directly.
+class OutputBuffer {
+public:
+    explicit OutputBuffer(FILE* f) : m_file(f) { m_buf.reserve(FLUSH_AT + 4096); }
+    ~OutputBuffer() { Flush(); }
+    std::string& Buf() { return m_buf; }
+    void MaybeFlush() { if (m_buf.size() >= FLUSH_AT) Flush(); }
+    void Flush()
+    {
+        if (!m_buf.empty() && fwrite(m_buf.data(), 1, m_buf.size(), m_file) != m_buf.size()) m_failed = true;
+        m_written += m_buf.size();
+        m_buf.clear();
+    }
+    uint64_t Written() const { return m_written + m_buf.size(); }
+    bool Failed() const { return m_failed; }
+private:
+    static const size_t FLUSH_AT = 1024 * 1024;
+    FILE* m_file;
+    std::string m_buf;
+    uint64_t m_written = 0;
+    bool m_failed = false;
+};
+
+static void AppendUInt(std::string& out, uint64_t v)
+{
+    char tmp[24];
+    int n = 0;
+    do { tmp[n++] = (char)('0' + v % 10); v /= 10; } while (v);
+    while (n) out.push_back(tmp[--n]);
+}
+
+static void AppendCsvField(std::string& out, const std::string& text)
+{
+    if (text.find_first_of(",\"\r\n") == std::string::npos) { out += text; return; }
+    out.push_back('"');
+    for (char c : text) {
+        if (c == '"') out.push_back('"');
+        out.push_back(c);
+    }
+    out.push_back('"');
+}
+
+// Escapes for JSON and replaces malformed UTF-8 with U+FFFD so every row parses.
+static void AppendJsonString(std::string& out, const std::string& text)
+{
+    static const char hex[] = "0123456789abcdef";
+    out.push_back('"');
+    const unsigned char* p = (const unsigned char*)text.data();
+    size_t n = text.size();
+    for (size_t i = 0; i < n;) {
+        unsigned char c = p[i];
+        if (c < 0x80) {
+            if (c == '"' || c == '\\') { out.push_back('\\'); out.push_back((char)c); }
+            else if (c == '\n') out += "\\n";
+            else if (c == '\r') out += "\\r";
+            else if (c == '\t') out += "\\t";
+            else if (c < 0x20 || c == 0x7F) { out += "\\u00"; out.push_back(hex[c >> 4]); out.push_back(hex[c & 15]); }
+            else out.push_back((char)c);
+            i++;
+            continue;
+        }
+        size_t len = (c & 0xE0) == 0xC0 ? 2 : (c & 0xF0) == 0xE0 ? 3 : (c & 0xF8) == 0xF0 ? 4 : 0;
+        bool valid = len != 0 && i + len <= n && c != 0xC0 && c != 0xC1 && c < 0xF5;
+        for (size_t k = 1; valid && k < len; k++) valid = (p[i + k] & 0xC0) == 0x80;
+        if (valid) {
+            out.append((const char*)p + i, len);
+            i += len;
+        }
+        else {
+            out += "\xEF\xBF\xBD";
+            i++;
+        }
+    }
+    out.push_back('"');
+}
+
+static void PutU32(std::string& out, uint32_t v) { out.append((const char*)&v, 4); }
+static void PutU64(std::string& out, uint64_t v) { out.append((const char*)&v, 8); }
+
+static void PutVarint(std::string& out, uint64_t v)
+{
+    while (v >= 0x80) { out.push_back((char)(v | 0x80)); v >>= 7; }
+    out.push_back((char)v);
+}
+
+// Accumulates one block of rows; memory is bounded by COLUMNAR_BLOCK_ROWS.
+class ColumnarWriter {
+public:
+    explicit ColumnarWriter(OutputBuffer& out) : m_out(out)
+    {
+        m_out.Buf().append("SMCOL1\0\0", 8);
+    }
+    void Add(const CaptureLine& line)
+    {
+        if (m_rows == 0) { m_baseTime = line.timeMs; m_prevTime = line.timeMs; }
+        int64_t delta = (int64_t)(line.timeMs - m_prevTime);
+        PutVarint(m_ts, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+        m_prevTime = line.timeMs;
+
+        auto it = m_dict.find(line.text);
+        uint32_t id;
+        if (it == m_dict.end()) {
+            id = (uint32_t)m_offsets.size();
+            m_dict.emplace(line.text, id);
+            m_offsets.push_back((uint32_t)m_blob.size());
+            m_blob += line.text;
+        }
+        else {
+            id = it->second;
+        }
+        PutVarint(m_ids, id);
+        if (++m_rows == COLUMNAR_BLOCK_ROWS) FlushBlock();
+    }
+    void Finish()
+    {
+        FlushBlock();
+        m_out.Flush();
+        uint64_t indexOffset = m_out.Written();
+        std::string& b = m_out.Buf();
+        b.append("IDX1", 4);
+        PutU32(b, (uint32_t)m_blockOffsets.size());
+        for (uint64_t off : m_blockOffsets) PutU64(b, off);
+        PutU64(b, indexOffset);
+        PutU64(b, m_totalRows);
+        b.append("SMCOLEND", 8);
+    }
+private:
+    void FlushBlock()
+    {
+        if (m_rows == 0) return;
+        m_out.Flush();
+        m_blockOffsets.push_back(m_out.Written());
+        std::string& b = m_out.Buf();
+        b.append("BLK1", 4);
+        PutU32(b, m_rows);
+        PutU32(b, (uint32_t)m_offsets.size());
+        PutU32(b, (uint32_t)m_ts.size());
+        PutU32(b, (uint32_t)m_ids.size());
+        PutU32(b, (uint32_t)m_blob.size());
+        PutU64(b, m_baseTime);
+        b += m_ts;
+        b += m_ids;
+        for (uint32_t off : m_offsets) PutU32(b, off);
+        PutU32(b, (uint32_t)m_blob.size());
+        b += m_blob;
+        m_out.MaybeFlush();
+        m_totalRows += m_rows;
+        m_rows = 0;
+        m_ts.clear();
+        m_ids.clear();
+        m_blob.clear();
+        m_offsets.clear();
+        m_dict.clear();
+    }
+    OutputBuffer& m_out;
+    uint32_t m_rows = 0;
+    uint64_t m_totalRows = 0, m_baseTime = 0, m_prevTime = 0;
+    std::string m_ts, m_ids, m_blob;
+    std::vector<uint32_t> m_offsets;
+    std::unordered_map<std::string, uint32_t> m_dict;
+    std::vector<uint64_t> m_blockOffsets;
+};
+
+bool RunExport(const ExportRequest& request, ExportStatus& status)
+{
+    status.permille = 0;
+    status.rows = 0;
+    status.error.clear();
+
+    CaptureReader reader;
+    if (!request.sourcePath.empty() && !reader.Open(request.sourcePath)) {
+        status.error = "cannot open " + request.sourcePath;
+        return false;
+    }
+    // Rows go to a side file that only replaces the target once complete, so a
+    // cancelled or failed export leaves no partial file (and keeps an old one)
+    std::string partPath = request.targetPath + ".part";
+    FILE* f = OpenFileUtf8(partPath, "wb");
+    if (!f) {
+        status.error = "cannot create " + partPath;
+        return false;
+    }
+
+    bool ok = true;
+    {
+        OutputBuffer out(f);
+        ColumnarWriter* columnar = nullptr;
+        if (request.format == EF_CSV) out.Buf() += "time,time_ms,text\n";
+        else if (request.format == EF_COLUMNAR) columnar = new ColumnarWriter(out);
+
+        TimestampFormatter formatter;
+        char stamp[TIMESTAMP_LEN];
+        CaptureLine scratch;
+        size_t index = 0;
+        uint64_t rows = 0;
+        for (;;) {
+            const CaptureLine* line;
+            if (request.sourcePath.empty()) {
+                if (index == request.lines.size()) break;
+                line = &request.lines[index++];
+            }
+            else {
+                if (!reader.Next(scratch)) break;
+                line = &scratch;
+            }
+            if (line->timeMs < request.fromMs || line->timeMs > request.toMs) continue;
+
+            std::string& b = out.Buf();
+            if (request.format == EF_CSV) {
+                formatter.Format(line->timeMs, stamp);
+                b.append(stamp, TIMESTAMP_LEN);
+                b.push_back(',');
+                AppendUInt(b, line->timeMs);
+                b.push_back(',');
+                AppendCsvField(b, line->text);
+                b.push_back('\n');
+            }
+            else if (request.format == EF_JSONL) {
+                formatter.Format(line->timeMs, stamp);
+                b += "{\"time\":\"";
+                b.append(stamp, TIMESTAMP_LEN);
+                b += "\",\"time_ms\":";
+                AppendUInt(b, line->timeMs);
+                b += ",\"text\":";
+                AppendJsonString(b, line->text);
+                b += "}\n";
+            }
+            else {
+                columnar->Add(*line);
+            }
+            out.MaybeFlush();
+
+            if ((++rows & 0xFFF) == 0) {
+                status.rows = rows;
+                if (request.sourcePath.empty()) status.permille = (int)(index * 1000 / request.lines.size());
+                else if (reader.FileSize()) status.permille = (int)(reader.BytesRead() * 1000 / reader.FileSize());
+                if (status.cancel) { status.error = "cancelled"; ok = false; break; }
+            }
+        }
+        if (columnar) {
+            if (ok) columnar->Finish();
+            delete columnar;
+        }
+        out.Flush();
+        status.rows = rows;
+        if (out.Failed()) { status.error = "write failed"; ok = false; }
+    }
+    if (fclose(f) != 0 && ok) { status.error = "write failed"; ok = false; }
+    if (ok && !ReplaceFileUtf8(partPath, request.targetPath)) { status.error = "cannot create " + request.targetPath; ok = false; }
+    if (!ok) RemoveFileUtf8(partPath);
+    else status.permille = 1000;
+    return ok;
+}
+
+bool ParseExportTime(const std::string& text, bool endOfSecond, uint64_t& timeMs)
+{
+    std::string stamp = text;
+    if (stamp.size() == TIMESTAMP_LEN - 4) stamp += endOfSecond ? ".999" : ".000";
+    if (stamp.size() != TIMESTAMP_LEN) return false;
+    if (stamp[10] == 'T') stamp[10] = ' ';
+    TimestampParser parser;
+    return parser.Parse(stamp.data(), stamp.size(), timeMs);
+}
+
+ExportFormat ExportFormatForPath(const std::string& path)
+{
+    size_t dot = path.find_last_of('.');
+    std::string ext = dot == std::string::npos ? std::string() : path.substr(dot);
+    for (char& c : ext) if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+    if (ext == ".jsonl") return EF_JSONL;
+    if (ext == ".smcol") return EF_COLUMNAR;
+    return EF_CSV;
+}
+
+bool ExportJob::Start(ExportRequest request)
+{
+    if (Running()) return false;
+    if (m_thread.joinable()) m_thread.join();
+    m_status.cancel = false;
+    m_finished = false;
+    m_thread = std::thread([this](ExportRequest req) {
+        m_result = RunExport(req, m_status);
+        m_finished = true;
+    }, std::move(request));
+    return true;
+}
+
+void ExportJob::Cancel()
+{
+    m_status.cancel = true;
+    if (m_thread.joinable()) m_thread.join();
+}
+
+bool ExportJob::Collect(std::string& error, uint64_t& rows)
+{
+    if (m_thread.joinable()) m_thread.join();
+    error = m_status.error;
+    rows = m_status.rows;
+    return m_result;
+}
@@ -0,0 +1,70 @@
+// Exporter.h : streams scrollback or capture files out as CSV, JSON Lines or columnar binary
+//
+
+#pragma once
+
+#include "CaptureFile.h"
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum ExportFormat { EF_CSV, EF_JSONL, EF_COLUMNAR };
+
+// Columnar layout ("SMCOL1"): a sequence of blocks of up to COLUMNAR_BLOCK_ROWS
+// rows, each holding a zigzag-delta varint timestamp column and a text column
+// of varint dictionary ids plus the block's dictionary as u32 offsets + blob.
+// A trailer gives the block index so readers can seek by block.
+//
+//   "SMCOL1\0\0"
+//   block*: "BLK1" u32 rows u32 dictCount u32 tsBytes u32 idBytes u32 blobBytes
+//           u64 baseTimeMs  ts[tsBytes]  ids[idBytes]  u32 offsets[dictCount + 1]  blob[blobBytes]
+//   "IDX1" u32 blockCount u64 blockOffsets[blockCount]
+//   u64 indexOffset u64 totalRows "SMCOLEND"
+#define COLUMNAR_BLOCK_ROWS 65536
+
+struct ExportRequest {
+    ExportFormat format = EF_CSV;
+    std::string sourcePath;            // capture file; empty exports `lines` instead
+    std::vector<CaptureLine> lines;    // scrollback snapshot
+    std::string targetPath;
+    uint64_t fromMs = 0;               // inclusive time range filter (--from/--to)
+    uint64_t toMs = UINT64_MAX;
+};
+
+// Parses a range bound in local time, "YYYY-MM-DD HH:MM:SS" with optional
+// ".mmm". Without milliseconds endOfSecond picks .999, so "--to 12:00:05"
+// still includes rows from within that second.
+bool ParseExportTime(const std::string& text, bool endOfSecond, uint64_t& timeMs);
+// Format implied by the target extension: .jsonl, .smcol, anything else CSV.
+ExportFormat ExportFormatForPath(const std::string& path);
+
+struct ExportStatus {
+    std::atomic<int> permille{ 0 };
+    std::atomic<uint64_t> rows{ 0 };
+    std::atomic<bool> cancel{ false };
+    std::string error;                 // valid once the export has finished
+};
+
+// Runs the export on the calling thread, reading and writing in bounded chunks.
+// The target only appears (or is replaced) once the export has succeeded.
+bool RunExport(const ExportRequest& request, ExportStatus& status);
+
+// Background wrapper used by the GUI; poll Status() and Finished().
+class ExportJob {
+public:
+    ~ExportJob() { Cancel(); }
+    bool Start(ExportRequest request);
+    void Cancel();
+    bool Running() const { return m_thread.joinable() && !m_finished; }
+    bool Finished() const { return m_finished; }
+    // Joins the worker after it finished; returns its result.
+    bool Collect(std::string& error, uint64_t& rows);
+    const ExportStatus& Status() const { return m_status; }
+private:
+    std::thread m_thread;
+    ExportStatus m_status;
+    std::atomic<bool> m_finished{ false };
+    bool m_result = false;
+};
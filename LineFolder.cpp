@@ -0,0 +1,44 @@
+#include "LineFolder.h"
+#include <string.h>
+
+static size_t TrimLineEnd(const char* text, size_t len)
+{
+    while (len > 0 && (text[len - 1] == '\n' || text[len - 1] == '\r')) len--;
+    return len;
+}
+
+uint64_t LineFolder::Hash(const char* text, size_t len, bool maskNumbers)
+{
+    const uint64_t prime = 1099511628211ULL;
+    uint64_t h = 14695981039346656037ULL;
+    const unsigned char* p = (const unsigned char*)text;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = p[i];
+        if (maskNumbers && c >= '0' && c <= '9') {
+            while (i + 1 < len && ((p[i + 1] >= '0' && p[i + 1] <= '9') ||
+                (p[i + 1] == '.' && i + 2 < len && p[i + 2] >= '0' && p[i + 2] <= '9'))) i++;
+            c = '#';
+        }
+        h = (h ^ c) * prime;
+    }
+    return h;
+}
+
+bool LineFolder::Add(uint64_t timeMs, const char* text, size_t len)
+{
+    if (m_mode == FOLD_OFF) return false;
+    len = TrimLineEnd(text, len);
+    uint64_t h = Hash(text, len, m_mode == FOLD_TEMPLATE);
+    bool same = m_count > 0 && h == m_hash;
+    if (same && m_mode == FOLD_EXACT) same = m_text.size() == len && memcmp(m_text.data(), text, len) == 0;
+    if (same) {
+        m_count++;
+        m_lastMs = timeMs;
+        return true;
+    }
+    m_hash = h;
+    m_count = 1;
+    m_firstMs = m_lastMs = timeMs;
+    if (m_mode == FOLD_EXACT) m_text.assign(text, len);
+    return false;
+}
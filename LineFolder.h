@@ -0,0 +1,39 @@
+// LineFolder.h : collapses runs of repeated lines before they reach the display
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+enum FoldMode {
+    FOLD_OFF,        // every line is its own row
+    FOLD_EXACT,      // identical lines fold
+    FOLD_TEMPLATE    // lines that differ only in their numbers fold
+};
+
+// Tracks the current run of consecutive matching lines. Each line is hashed in
+// one pass (trailing CR/LF ignored, digit runs masked in template mode), so a
+// repeat costs a hash and a compare instead of a UI row.
+class LineFolder {
+public:
+    void SetMode(FoldMode mode) { if (mode != m_mode) { m_mode = mode; Reset(); } }
+    FoldMode Mode() const { return m_mode; }
+    // Returns true if the line joined the current run, false if it starts a new one.
+    bool Add(uint64_t timeMs, const char* text, size_t len);
+    void Reset() { m_count = 0; }
+    uint32_t Count() const { return m_count; }
+    uint64_t FirstMs() const { return m_firstMs; }
+    uint64_t LastMs() const { return m_lastMs; }
+
+    // 64-bit FNV-1a over the line; with maskNumbers every run of digits (and
+    // the dots between them) hashes as a single '#'.
+    static uint64_t Hash(const char* text, size_t len, bool maskNumbers);
+private:
+    FoldMode m_mode = FOLD_OFF;
+    uint32_t m_count = 0;
+    uint64_t m_hash = 0;
+    uint64_t m_firstMs = 0;
+    uint64_t m_lastMs = 0;
+    std::string m_text;  // exact mode confirms hash hits against the run's text
+};
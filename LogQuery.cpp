@@ -0,0 +1,538 @@
+#include "LogQuery.h"
+#include <algorithm>
+#include <chrono>
+#include <regex>
+#include <string.h>
+#include <thread>
+#include <time.h>
+#include <unordered_map>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define QUERY_SSE2 1
+#endif
+
+static const size_t MAX_LINE_TEXT = 1000;
+static const size_t MAX_CACHED_MATCHES = 20000;
+static const size_t MAX_CACHED_QUERIES = 16;
+
+struct LogFileInfo {
+    std::string name;
+    uint64_t size = 0;
+    uint64_t mtime = 0;
+    uint64_t timeMs = 0;
+};
+
+// --- MappedFile ---
+
+bool MappedFile::Open(const std::string& path)
+{
+    Close();
+#ifdef _WIN32
+    wchar_t pathW[MAX_PATH * 2];
+    if (MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, pathW, MAX_PATH * 2) == 0) return false;
+    // Share write so the log being captured right now can still be searched
+    HANDLE hFile = CreateFileW(pathW, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(hFile, &size)) {
+        CloseHandle(hFile);
+        return false;
+    }
+    if (size.QuadPart == 0) {
+        // Nothing to map; an empty file is a valid, empty view
+        CloseHandle(hFile);
+        return true;
+    }
+    HANDLE hMapping = CreateFileMappingW(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    const void* view = hMapping ? MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!view) {
+        if (hMapping) CloseHandle(hMapping);
+        CloseHandle(hFile);
+        return false;
+    }
+    m_file = hFile;
+    m_mapping = hMapping;
+    m_data = (const char*)view;
+    m_size = (size_t)size.QuadPart;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return true;
+    }
+    void* view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) return false;
+    madvise(view, (size_t)st.st_size, MADV_SEQUENTIAL);
+    m_data = (const char*)view;
+    m_size = (size_t)st.st_size;
+#endif
+    return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+    if (m_data) UnmapViewOfFile(m_data);
+    if (m_mapping) CloseHandle(m_mapping);
+    if (m_file) CloseHandle(m_file);
+    m_mapping = m_file = nullptr;
+#else
+    if (m_data) munmap((void*)m_data, m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
+// --- File listing ---
+
+bool ParseLogFileTime(const std::string& name, uint64_t& timeMs)
+{
+    // log_<port>_YYYY-MM-DD_HH-MM-SS.txt; the port itself never contains '_'
+    if (name.compare(0, 4, "log_") != 0 || name.size() < 4 + 1 + 19 + 4) return false;
+    const char* p = name.c_str() + name.size() - 4 - 19;
+    int year, mon, day, hour, min, sec;
+    if (sscanf(p, "%4d-%2d-%2d_%2d-%2d-%2d", &year, &mon, &day, &hour, &min, &sec) != 6) return false;
+    struct tm tmLocal = {};
+    tmLocal.tm_year = year - 1900;
+    tmLocal.tm_mon = mon - 1;
+    tmLocal.tm_mday = day;
+    tmLocal.tm_hour = hour;
+    tmLocal.tm_min = min;
+    tmLocal.tm_sec = sec;
+    tmLocal.tm_isdst = -1;
+    time_t t = mktime(&tmLocal);
+    if (t == (time_t)-1) return false;
+    timeMs = (uint64_t)t * 1000;
+    return true;
+}
+
+static bool ListLogFiles(const std::string& folder, std::vector<LogFileInfo>& files)
+{
+#ifdef _WIN32
+    wchar_t patternW[MAX_PATH * 2];
+    if (MultiByteToWideChar(CP_UTF8, 0, (folder + "\\log_*.txt").c_str(), -1, patternW, MAX_PATH * 2) == 0) return false;
+    WIN32_FIND_DATAW fd;
+    HANDLE hFind = FindFirstFileW(patternW, &fd);
+    if (hFind == INVALID_HANDLE_VALUE) return GetLastError() == ERROR_FILE_NOT_FOUND;
+    do {
+        if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+        char nameA[MAX_PATH * 3];
+        WideCharToMultiByte(CP_UTF8, 0, fd.cFileName, -1, nameA, sizeof(nameA), NULL, NULL);
+        LogFileInfo info;
+        info.name = nameA;
+        info.size = ((uint64_t)fd.nFileSizeHigh << 32) | fd.nFileSizeLow;
+        info.mtime = ((uint64_t)fd.ftLastWriteTime.dwHighDateTime << 32) | fd.ftLastWriteTime.dwLowDateTime;
+        files.push_back(info);
+    } while (FindNextFileW(hFind, &fd));
+    FindClose(hFind);
+#else
+    DIR* dir = opendir(folder.c_str());
+    if (!dir) return false;
+    while (dirent* ent = readdir(dir)) {
+        std::string name = ent->d_name;
+        if (name.size() < 8 || name.compare(0, 4, "log_") != 0 || name.compare(name.size() - 4, 4, ".txt") != 0) continue;
+        struct stat st;
+        if (stat((folder + "/" + name).c_str(), &st) != 0 || !S_ISREG(st.st_mode)) continue;
+        LogFileInfo info;
+        info.name = name;
+        info.size = (uint64_t)st.st_size;
+        info.mtime = (uint64_t)st.st_mtime;
+        files.push_back(info);
+    }
+    closedir(dir);
+#endif
+    for (LogFileInfo& f : files) {
+        if (!ParseLogFileTime(f.name, f.timeMs)) f.timeMs = 0;
+    }
+    return true;
+}
+
+// --- Matching ---
+
+static inline unsigned char FoldByte(unsigned char c) { return (c >= 'A' && c <= 'Z') ? (unsigned char)(c | 0x20) : c; }
+
+// Substring search that compares the needle's first and last bytes across 16
+// positions at a time and only verifies the survivors.
+class LiteralSearcher {
+public:
+    LiteralSearcher(const std::string& needle, bool ignoreCase) : m_needle(needle), m_ignoreCase(ignoreCase)
+    {
+        if (ignoreCase) for (char& c : m_needle) c = (char)FoldByte((unsigned char)c);
+    }
+    bool Empty() const { return m_needle.empty(); }
+    const char* Find(const char* p, const char* end) const
+    {
+        size_t n = m_needle.size();
+        if (n == 0 || (size_t)(end - p) < n) return nullptr;
+        const unsigned char first = (unsigned char)m_needle[0], last = (unsigned char)m_needle[n - 1];
+#ifdef QUERY_SSE2
+        const unsigned char foldFirst = (m_ignoreCase && first >= 'a' && first <= 'z') ? 0x20 : 0;
+        const unsigned char foldLast = (m_ignoreCase && last >= 'a' && last <= 'z') ? 0x20 : 0;
+        const __m128i vFirst = _mm_set1_epi8((char)first), vLast = _mm_set1_epi8((char)last);
+        const __m128i vFoldFirst = _mm_set1_epi8((char)foldFirst), vFoldLast = _mm_set1_epi8((char)foldLast);
+        while (p + n - 1 + 16 <= end) {
+            __m128i a = _mm_or_si128(_mm_loadu_si128((const __m128i*)p), vFoldFirst);
+            __m128i b = _mm_or_si128(_mm_loadu_si128((const __m128i*)(p + n - 1)), vFoldLast);
+            int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, vFirst), _mm_cmpeq_epi8(b, vLast)));
+            while (mask) {
+                int bit = CountTrailingZeros(mask);
+                if (Verify(p + bit)) return p + bit;
+                mask &= mask - 1;
+            }
+            p += 16;
+        }
+#endif
+        for (; p + n <= end; p++) {
+            unsigned char c = (unsigned char)*p;
+            if ((m_ignoreCase ? FoldByte(c) : c) == first && Verify(p)) return p;
+        }
+        return nullptr;
+    }
+private:
+    static int CountTrailingZeros(int mask)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, (unsigned long)mask);
+        return (int)index;
+#else
+        return __builtin_ctz((unsigned)mask);
+#endif
+    }
+    bool Verify(const char* p) const
+    {
+        if (!m_ignoreCase) return memcmp(p, m_needle.data(), m_needle.size()) == 0;
+        for (size_t i = 0; i < m_needle.size(); i++) {
+            if (FoldByte((unsigned char)p[i]) != (unsigned char)m_needle[i]) return false;
+        }
+        return true;
+    }
+    std::string m_needle;
+    bool m_ignoreCase;
+};
+
+// Longest run of plain characters every match of the regex must contain, used
+// as the SIMD prefilter. Only escaped metacharacters join a run; any other
+// escape ends it. Gives up (returns "") on alternation.
+static std::string RequiredLiteral(const std::string& re)
+{
+    if (re.find('|') != std::string::npos) return std::string();
+    std::string best, run;
+    int depth = 0;
+    auto endRun = [&]() { if (run.size() > best.size()) best = run; run.clear(); };
+    for (size_t i = 0; i < re.size(); i++) {
+        char c = re[i];
+        char next = i + 1 < re.size() ? re[i + 1] : 0;
+        bool optional = next == '?' || next == '*' || next == '{';
+        if (c == '\\' && i + 1 < re.size()) {
+            char e = re[++i];
+            // \xHH, \uHHHH, \cX and back-references end the run; their operands are not text
+            size_t operand = e == 'x' ? 2 : e == 'u' ? 4 : e == 'c' ? 1 : 0;
+            while (operand-- > 0 && i + 1 < re.size()) i++;
+            if (e >= '0' && e <= '9') while (i + 1 < re.size() && re[i + 1] >= '0' && re[i + 1] <= '9') i++;
+            next = i + 1 < re.size() ? re[i + 1] : 0;
+            optional = next == '?' || next == '*' || next == '{';
+            if (depth == 0 && e != 0 && strchr(".*+?()[]{}|^$\\/-", e) && !optional) { run.push_back(e); if (next == '+') endRun(); }
+            else endRun();
+            continue;
+        }
+        if (c == '[') {
+            endRun();
+            while (i < re.size() && re[i] != ']') i += (re[i] == '\\') ? 2 : 1;
+            continue;
+        }
+        if (c == '{') {
+            // Quantifier bounds are not text
+            endRun();
+            while (i < re.size() && re[i] != '}') i++;
+            continue;
+        }
+        if (c == '(') { depth++; endRun(); continue; }
+        if (c == ')') { depth--; endRun(); continue; }
+        if (strchr(".^$*+?{}", c)) { endRun(); continue; }
+        if (depth != 0 || optional) { endRun(); continue; }
+        run.push_back(c);
+        if (next == '+') endRun();
+    }
+    endRun();
+    return best;
+}
+
+struct QueryMatcher {
+    QueryOptions options;
+    LiteralSearcher literal{ std::string(), false };
+    std::regex re;
+    bool useRegex = false;
+};
+
+static void ScanFile(const std::string& folder, const LogFileInfo& info, const QueryMatcher& m,
+    std::vector<QueryMatch>& out, uint64_t& bytes)
+{
+    MappedFile file;
+#ifdef _WIN32
+    if (!file.Open(folder + "\\" + info.name)) return;
+#else
+    if (!file.Open(folder + "/" + info.name)) return;
+#endif
+    const char* data = file.Data();
+    const char* end = data + file.Size();
+    bytes += file.Size();
+    const char* counted = data;   // newlines before this point are in lineNo
+    uint32_t lineNo = 1;
+    const char* p = data;
+    while (p < end) {
+        const char* hit = m.literal.Empty() ? p : m.literal.Find(p, end);
+        if (!hit) break;
+        const char* lineStart = hit;
+        while (lineStart > p && lineStart[-1] != '\n') lineStart--;
+        const char* lineEnd = (const char*)memchr(hit, '\n', (size_t)(end - hit));
+        if (!lineEnd) lineEnd = end;
+        lineNo += (uint32_t)std::count(counted, lineStart, '\n');
+        counted = lineStart;
+
+        const char* textEnd = lineEnd;
+        if (textEnd > lineStart && textEnd[-1] == '\r') textEnd--;
+        bool match = true;
+        if (m.useRegex) match = std::regex_search(lineStart, textEnd, m.re);
+        if (match) {
+            QueryMatch qm;
+            qm.timeMs = info.timeMs;
+            qm.file = info.name;
+            qm.line = lineNo;
+            qm.text.assign(lineStart, std::min((size_t)(textEnd - lineStart), MAX_LINE_TEXT));
+            out.push_back(std::move(qm));
+            if (out.size() > 2 * m.options.maxResults) {
+                out.erase(out.begin(), out.end() - m.options.maxResults);
+            }
+        }
+        p = lineEnd + 1;
+    }
+    if (out.size() > m.options.maxResults) out.erase(out.begin(), out.end() - m.options.maxResults);
+}
+
+// --- Cache ---
+// "<folder>/.query-cache": per query, the stamp and matches of every file seen.
+
+struct CachedFile {
+    uint64_t size = 0, mtime = 0;
+    std::vector<QueryMatch> matches;
+};
+typedef std::unordered_map<std::string, CachedFile> CachedQuery;
+struct QueryCache {
+    std::vector<std::pair<std::string, CachedQuery>> queries;  // oldest first
+};
+
+static std::string CacheKey(const QueryOptions& o)
+{
+    return std::string(o.regex ? "re:" : "lit:") + (o.ignoreCase ? "i:" : "c:") + std::to_string(o.maxResults) + ":" + o.pattern;
+}
+
+static bool ReadU32(FILE* f, uint32_t& v) { return fread(&v, 4, 1, f) == 1; }
+static bool ReadU64(FILE* f, uint64_t& v) { return fread(&v, 8, 1, f) == 1; }
+static bool ReadStr(FILE* f, std::string& s)
+{
+    uint32_t len;
+    if (!ReadU32(f, len) || len > 16 * 1024 * 1024) return false;
+    s.resize(len);
+    return len == 0 || fread(&s[0], 1, len, f) == len;
+}
+static void WriteU32(FILE* f, uint32_t v) { fwrite(&v, 4, 1, f); }
+static void WriteU64(FILE* f, uint64_t v) { fwrite(&v, 8, 1, f); }
+static void WriteStr(FILE* f, const std::string& s) { WriteU32(f, (uint32_t)s.size()); fwrite(s.data(), 1, s.size(), f); }
+
+static FILE* OpenCacheFile(const std::string& folder, const char* mode)
+{
+#ifdef _WIN32
+    wchar_t pathW[MAX_PATH * 2], modeW[8];
+    if (MultiByteToWideChar(CP_UTF8, 0, (folder + "\\.query-cache").c_str(), -1, pathW, MAX_PATH * 2) == 0) return nullptr;
+    MultiByteToWideChar(CP_UTF8, 0, mode, -1, modeW, 8);
+    FILE* f = nullptr;
+    return _wfopen_s(&f, pathW, modeW) == 0 ? f : nullptr;
+#else
+    return fopen((folder + "/.query-cache").c_str(), mode);
+#endif
+}
+
+static void LoadCache(const std::string& folder, QueryCache& cache)
+{
+    FILE* f = OpenCacheFile(folder, "rb");
+    if (!f) return;
+    char magic[6];
+    bool ok = fread(magic, 1, 6, f) == 6 && memcmp(magic, "SMQC1\n", 6) == 0;
+    uint32_t queryCount = 0;
+    ok = ok && ReadU32(f, queryCount);
+    for (uint32_t q = 0; ok && q < queryCount; q++) {
+        std::pair<std::string, CachedQuery> entry;
+        uint32_t fileCount = 0;
+        ok = ReadStr(f, entry.first) && ReadU32(f, fileCount);
+        for (uint32_t i = 0; ok && i < fileCount; i++) {
+            std::string name;
+            CachedFile cf;
+            uint32_t matchCount = 0;
+            ok = ReadStr(f, name) && ReadU64(f, cf.size) && ReadU64(f, cf.mtime) && ReadU32(f, matchCount);
+            for (uint32_t k = 0; ok && k < matchCount; k++) {
+                QueryMatch m;
+                m.file = name;
+                ok = ReadU32(f, m.line) && ReadStr(f, m.text);
+                if (ok) cf.matches.push_back(std::move(m));
+            }
+            if (ok) entry.second.emplace(name, std::move(cf));
+        }
+        if (ok) cache.queries.push_back(std::move(entry));
+    }
+    fclose(f);
+    if (!ok) cache.queries.clear();
+}
+
+static void SaveCache(const std::string& folder, const QueryCache& cache)
+{
+    FILE* f = OpenCacheFile(folder, "wb");
+    if (!f) return;
+    fwrite("SMQC1\n", 1, 6, f);
+    WriteU32(f, (uint32_t)cache.queries.size());
+    for (const auto& entry : cache.queries) {
+        WriteStr(f, entry.first);
+        WriteU32(f, (uint32_t)entry.second.size());
+        for (const auto& file : entry.second) {
+            WriteStr(f, file.first);
+            WriteU64(f, file.second.size);
+            WriteU64(f, file.second.mtime);
+            WriteU32(f, (uint32_t)file.second.matches.size());
+            for (const QueryMatch& m : file.second.matches) {
+                WriteU32(f, m.line);
+                WriteStr(f, m.text);
+            }
+        }
+    }
+    fclose(f);
+}
+
+// --- Entry point ---
+
+bool RunLogQuery(const std::string& folder, const QueryOptions& options,
+    std::vector<QueryMatch>& results, QueryStats& stats, std::string& error)
+{
+    auto started = std::chrono::steady_clock::now();
+    results.clear();
+    stats = QueryStats();
+    if (options.pattern.empty()) { error = "empty query"; return false; }
+
+    QueryMatcher matcher;
+    matcher.options = options;
+    if (matcher.options.maxResults == 0) matcher.options.maxResults = 1;
+    if (options.regex) {
+        try {
+            auto flags = std::regex::ECMAScript | std::regex::optimize;
+            if (options.ignoreCase) flags |= std::regex::icase;
+            matcher.re = std::regex(options.pattern, flags);
+        }
+        catch (const std::regex_error& e) {
+            error = std::string("bad regex: ") + e.what();
+            return false;
+        }
+        matcher.useRegex = true;
+        matcher.literal = LiteralSearcher(RequiredLiteral(options.pattern), options.ignoreCase);
+    }
+    else {
+        matcher.literal = LiteralSearcher(options.pattern, options.ignoreCase);
+    }
+
+    std::vector<LogFileInfo> files;
+    if (!ListLogFiles(folder, files)) { error = "cannot list " + folder; return false; }
+    stats.filesTotal = files.size();
+
+    QueryCache cache;
+    std::string key = CacheKey(matcher.options);
+    CachedQuery* cached = nullptr;
+    if (options.useCache) {
+        LoadCache(folder, cache);
+        for (auto& entry : cache.queries) {
+            if (entry.first == key) cached = &entry.second;
+        }
+    }
+
+    // Files whose size and timestamp are unchanged reuse the cached matches
+    std::vector<std::vector<QueryMatch>> perFile(files.size());
+    std::vector<size_t> pending;
+    for (size_t i = 0; i < files.size(); i++) {
+        auto it = cached ? cached->find(files[i].name) : CachedQuery::iterator();
+        if (cached && it != cached->end() && it->second.size == files[i].size && it->second.mtime == files[i].mtime) {
+            perFile[i] = it->second.matches;
+            for (QueryMatch& m : perFile[i]) m.timeMs = files[i].timeMs;
+        }
+        else {
+            pending.push_back(i);
+        }
+    }
+
+    std::atomic<size_t> next{ 0 };
+    std::atomic<uint64_t> bytes{ 0 };
+    unsigned threadCount = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    if (threadCount > pending.size()) threadCount = (unsigned)std::max<size_t>(1, pending.size());
+    auto worker = [&]() {
+        uint64_t localBytes = 0;
+        for (size_t k; (k = next++) < pending.size();) {
+            size_t i = pending[k];
+            ScanFile(folder, files[i], matcher, perFile[i], localBytes);
+        }
+        bytes += localBytes;
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threadCount; t++) pool.emplace_back(worker);
+    worker();
+    for (std::thread& t : pool) t.join();
+    stats.filesScanned = pending.size();
+    stats.bytesScanned = bytes;
+
+    if (options.useCache) {
+        CachedQuery updated;
+        size_t total = 0;
+        for (size_t i = 0; i < files.size(); i++) {
+            CachedFile& cf = updated[files[i].name];
+            cf.size = files[i].size;
+            cf.mtime = files[i].mtime;
+            cf.matches = perFile[i];
+            total += perFile[i].size();
+        }
+        for (size_t i = 0; i < cache.queries.size(); i++) {
+            if (cache.queries[i].first == key) { cache.queries.erase(cache.queries.begin() + i); break; }
+        }
+        if (total <= MAX_CACHED_MATCHES) cache.queries.emplace_back(key, std::move(updated));
+        while (cache.queries.size() > MAX_CACHED_QUERIES) cache.queries.erase(cache.queries.begin());
+        if (!pending.empty() || cached == nullptr) SaveCache(folder, cache);
+    }
+
+    for (auto& v : perFile) {
+        for (QueryMatch& m : v) results.push_back(std::move(m));
+    }
+    std::sort(results.begin(), results.end(), [](const QueryMatch& a, const QueryMatch& b) {
+        if (a.timeMs != b.timeMs) return a.timeMs < b.timeMs;
+        if (a.file != b.file) return a.file < b.file;
+        return a.line < b.line;
+    });
+    if (results.size() > matcher.options.maxResults) {
+        results.erase(results.begin(), results.end() - matcher.options.maxResults);
+    }
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return true;
+}
@@ -0,0 +1,57 @@
+// LogQuery.h : parallel search across every log_COMx_*.txt file in the log folder
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+struct QueryOptions {
+    std::string pattern;             // UTF-8 literal, or ECMAScript regex when regex is set
+    bool regex = false;
+    bool ignoreCase = false;
+    size_t maxResults = 1000;        // newest results are kept
+    bool useCache = true;            // reuse per-file results for unchanged files
+    unsigned threads = 0;            // 0 = one per core
+};
+
+struct QueryMatch {
+    uint64_t timeMs = 0;             // log start time from the file name; lines keep file order
+    std::string file;                // file name relative to the folder
+    uint32_t line = 0;               // 1-based
+    std::string text;
+};
+
+struct QueryStats {
+    size_t filesTotal = 0;
+    size_t filesScanned = 0;         // the rest came from the cache
+    uint64_t bytesScanned = 0;
+    double seconds = 0;
+};
+
+// Scans the folder and returns matches sorted oldest first. Returns false and
+// fills error if the folder cannot be listed or the regex does not compile.
+bool RunLogQuery(const std::string& folder, const QueryOptions& options,
+    std::vector<QueryMatch>& results, QueryStats& stats, std::string& error);
+
+// Parses "log_<port>_YYYY-MM-DD_HH-MM-SS.txt" into local-time milliseconds.
+bool ParseLogFileTime(const std::string& name, uint64_t& timeMs);
+
+// Read-only memory-mapped view of a whole file.
+class MappedFile {
+public:
+    ~MappedFile() { Close(); }
+    bool Open(const std::string& path);
+    void Close();
+    const char* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+private:
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#endif
+};
@@ -15,6 +15,15 @@
 #define IDC_CANCEL_BUTTON   1009
 #define IDC_CLEAR_BUTTON    1010
 #define IDC_ANIMATION_CANVAS 1011
+#define IDC_TRIGGER_EDIT    1012
+#define IDC_SHARE_EDIT      1013
+#define IDC_EXPORT_BUTTON   1014
+#define IDC_QUERY_EDIT      1015
+#define IDC_QUERY_BUTTON    1016
+#define IDC_FOLD_COMBO      1017
+#define IDC_PROFILE_COMBO   1018
+#define IDC_PROFILE_SAVE    1019
+#define IDC_PROFILE_EDIT    1020
 
 #define IDS_APP_TITLE			103
 
@@ -27,6 +36,9 @@
 #define IDI_SMALL				108
 #define IDC_SERIALMONITOR			109
 #define IDC_MYICON				2
+#define IDM_EXPORT_SCROLLBACK	32771
+#define IDM_EXPORT_CAPTURE		32772
+#define IDM_MERGE_CAPTURES		32773
 #ifndef IDC_STATIC
 #define IDC_STATIC				-1
 #endif
@@ -37,7 +49,7 @@
 
 #define _APS_NO_MFC					130
 #define _APS_NEXT_RESOURCE_VALUE	129
-#define _APS_NEXT_COMMAND_VALUE		32771
+#define _APS_NEXT_COMMAND_VALUE		32774
 #define _APS_NEXT_CONTROL_VALUE		1000
 #define _APS_NEXT_SYMED_VALUE		110
 #endif
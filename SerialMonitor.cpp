@@ -1,16 +1,28 @@
 ﻿#include "framework.h"
 #include "SerialMonitor.h"
 #include "darktheme.h" 
+#include "CaptureTrigger.h"
+#include "StreamServer.h"
+#include "Exporter.h"
+#include "LogQuery.h"
+#include "CaptureMerge.h"
+#include "LineFolder.h"
+#include "SessionProfile.h"
 #include <windows.h>
 #include <string>
 #include <vector>
-#include <sstream> 
 #include <CommCtrl.h> 
 #include <ShlObj.h>   
+#include <wtsapi32.h>
+#include <commdlg.h>
+#include <algorithm>
+#include <deque>
 #include <time.h> 
 
 #pragma comment(lib, "Comctl32.lib")
 #pragma comment(lib, "Shell32.lib")
+#pragma comment(lib, "Comdlg32.lib")
+#pragma comment(lib, "Wtsapi32.lib")
 
 #define MAX_LOADSTRING 100
 
@@ -20,16 +32,51 @@
 #define WM_GUI_STATE_CONNECTING (WM_APP + 3)
 #define WM_GUI_STATE_CONNECTED  (WM_APP + 4)
 #define WM_CONNECTION_LOST      (WM_APP + 5)
+#define WM_QUERY_DONE           (WM_APP + 6)
+#define WM_MERGE_DONE           (WM_APP + 7)
+#define WM_LINE_FOLDED          (WM_APP + 8)
+#define WM_PORTS_ENUMERATED     (WM_APP + 9)
 
 // Timer ID
 #define IDT_RECONNECT_TIMER   1
 #define IDT_ANIMATION_TIMER 2
 #define IDT_WATCHDOG_TIMER  3
+#define IDT_EXPORT_TIMER    4
 
 // Struct to pass timestamped log data
 struct LogEntry {
     std::wstring timestamp;
     std::wstring message;
+    uint64_t timeMs = 0; // Full receive time, kept for export
+    COLORREF color = RGB(0, 255, 0); // Message colour, from the profile's highlight rules
+    uint64_t rowId = 0; // Increasing per posted row, so fold updates find their row
+    uint32_t repeats = 1; // Lines folded into this row, including itself
+    uint64_t lastRepeatMs = 0;
+};
+
+// Handed to SerialThread, which owns and deletes it
+struct SerialSession {
+    HWND hWnd;
+    SessionProfile profile;
+};
+
+// Repeat count of a row, posted instead of a row per repeated line
+struct FoldUpdate {
+    uint64_t rowId;
+    uint32_t count;
+    uint64_t lastMs;
+};
+
+// Front end of RunSerialReader: the window posts rows, --headless prints them.
+class SerialSink {
+public:
+    virtual ~SerialSink() {}
+    virtual bool KeepReading() = 0;
+    virtual void OnStatus(const std::wstring& text) = 0;
+    // Lines completed by one read, each with its delimiter, all stamped with that read's time
+    virtual void OnLines(uint64_t readTime, std::vector<std::string>& lines) = 0;
+    // About every 100 ms, for updates that are batched rather than sent per line
+    virtual void OnTick() {}
 };
 
 // Global Variables
@@ -37,11 +84,42 @@ HINSTANCE hInst;
 WCHAR szTitle[MAX_LOADSTRING];
 WCHAR szWindowClass[MAX_LOADSTRING];
 HWND hPortCombo, hBaudCombo, hStartButton, hStopButton, hOutputListView, hRefreshButton;
-HWND hLogDirEdit, hBrowseButton, hStatusLabel, hCancelButton, hClearButton;
+HWND hLogDirEdit, hBrowseButton, hStatusLabel, hCancelButton, hClearButton, hTriggerEdit, hShareEdit, hExportButton;
+HWND hQueryEdit, hQueryButton, hFoldCombo, hProfileCombo, hProfileSaveButton, hProfileEditButton, hQueryWindow = NULL, hQueryListView, hMergeWindow = NULL, hMergeListView;
 HANDLE hThread = NULL;
 volatile bool bShouldBeMonitoring = false;
 HBRUSH g_brBackground = CreateSolidBrush(RGB(0, 0, 0));
 HBRUSH g_brEditBackground = CreateSolidBrush(RGB(20, 20, 20));
+StreamServer g_streamServer; // Local fan-out of the live stream, outlives reconnects
+std::deque<LogEntry> g_scrollback; // Mirrors the list view rows with full timestamps
+volatile LONG64 g_nextRowId = 0; // Row ids stay unique across reconnects
+ExportJob g_exportJob;
+volatile LONG g_uiBacklog = 0; // Rows posted by the serial thread and not yet added
+volatile LONG g_foldMode = FOLD_OFF; // Read by the serial thread on every batch
+SessionProfile g_profile; // Loaded profile; line settings, decoder, highlights and log policy have no controls
+volatile LONG g_firstByteReported = 0; // Cold start to first byte is reported once per process
+
+// Log folder query, run on a worker thread and handed back via WM_QUERY_DONE
+struct QueryJob {
+    HWND hWnd;
+    std::string folder;
+    QueryOptions options;
+    std::vector<QueryMatch> results;
+    QueryStats stats;
+    std::string error;
+    bool ok = false;
+};
+bool g_queryRunning = false;
+
+// Capture merge, same hand-off as the query via WM_MERGE_DONE
+struct MergeJob {
+    HWND hWnd;
+    MergeRequest request;
+    MergeStatus status;
+    bool ok = false;
+};
+MergeJob* g_mergeJob = nullptr;     // running merge, freed by WM_MERGE_DONE or CancelMerge
+HANDLE g_hMergeThread = NULL;
 
 // ANIMATION GLOBALS
 #define ANIMATION_WIDTH 280
@@ -53,10 +131,30 @@ enum AnimationState { AS_IDLE, AS_ANIMATING_IDLE, AS_ANIMATING_ACTIVE };
 AnimationState g_animState = AS_IDLE;
 struct Fish {
     bool is_swimming = false;
-    const wchar_t* sprite = L"";
+    int sprite = 0; // Index into fishFrames
     int x = 0, y = 0, lifespan = 0;
-    COLORREF color; // Fish color
+    int color = 0;  // Index into fishColors
 } g_fish;
+// Sprites are rendered once into an atlas; each frame is composed into a
+// persistent back buffer by blitting, and WM_DRAWITEM just copies it out.
+struct AnimationCache {
+    HDC hdcAtlas = NULL, hdcMask = NULL, hdcBack = NULL;
+    HBITMAP hbmAtlas = NULL, hbmMask = NULL, hbmBack = NULL;
+    HGDIOBJ oldAtlas = NULL, oldMask = NULL, oldBack = NULL;
+    RECT cat[6];    // idle 1-4, active 1-2
+    RECT water[8];  // pattern * 2 + colour
+    RECT fish[15];  // sprite * 5 + colour
+} g_animCache;
+UINT g_animInterval = 0;         // Current timer period, 0 when stopped
+bool g_animSessionHidden = false; // Workstation locked or remote session disconnected
+bool g_animThrottled = false;     // UI backlog from the serial thread
+// Cost of each presented frame: composing it plus the WM_DRAWITEM copy to the screen.
+struct AnimationStats {
+    uint64_t frames = 0;
+    uint64_t totalTicks = 0;
+    uint64_t maxTicks = 0;
+    uint64_t pendingTicks = 0;   // composition not yet presented
+} g_animStats;
 
 
 // Forward Declarations
@@ -67,14 +165,78 @@ void                CreateControls(HWND hWnd);
 void                StartMonitoring(HWND hWnd);
 void                StopMonitoring();
 DWORD WINAPI        SerialThread(LPVOID lpParam);
+bool                RunSerialReader(HANDLE hSerial, const SessionProfile& profile, SerialSink& sink);
 void                AddLogEntry(const LogEntry* entry);
 void                SaveSettings();
 void                LoadSettings();
 void                PopulatePorts();
 void                DrawAnimationFrame();
+void                CreateAnimationCache(HWND hWnd);
+void                DestroyAnimationCache();
+void                UpdateAnimationTimer(HWND hWnd);
+void                PostStatus(HWND hWnd, const std::wstring& text);
+void                StartExport(HWND hWnd, bool fromCapture);
+void                AttachCommandConsole();
+int                 RunExportCommand(int argc, LPWSTR* argv);
+void                StartQuery(HWND hWnd);
+DWORD WINAPI        QueryThread(LPVOID lpParam);
+void                ShowQueryResults(HWND hWnd, const QueryJob* job);
+LRESULT CALLBACK    QueryWndProc(HWND, UINT, WPARAM, LPARAM);
+int                 RunQueryCommand(int argc, LPWSTR* argv);
+void                StartMerge(HWND hWnd);
+void                CancelMerge(bool wait);
+DWORD WINAPI        MergeThread(LPVOID lpParam);
+void                ShowMergeResults(HWND hWnd, const MergeJob* job);
+LRESULT CALLBACK    MergeWndProc(HWND, UINT, WPARAM, LPARAM);
+int                 RunMergeCommand(int argc, LPWSTR* argv);
+int                 RunHeadlessCommand(int argc, LPWSTR* argv);
+DWORD WINAPI        PortEnumThread(LPVOID lpParam);
+HANDLE              OpenSerialPort(const SessionProfile& profile, std::wstring& warning);
+HANDLE              OpenLogFile(const SessionProfile& profile);
+void                WriteRawLog(const SessionProfile& profile, HANDLE& hLogFile, uint64_t& logBytes, const char* data, DWORD len);
+std::wstring        ProfileLogDir(const SessionProfile& profile);
+std::wstring        ProfilesDir();
+std::wstring        ProfilePath(const std::wstring& name);
+std::wstring        SessionProfilePath();
+bool                CheckProfileName(HWND hWnd, const std::wstring& name);
+void                RefreshProfileList();
+bool                LoadProfileByName(HWND hWnd, const std::wstring& name);
+void                SaveCurrentProfile(HWND hWnd);
+void                EditCurrentProfile(HWND hWnd);
+void                ApplyProfileToControls(const SessionProfile& profile);
+void                ReadProfileFromControls(SessionProfile& profile);
+void                SelectOrAddComboString(HWND hCombo, const std::wstring& text);
+double              MillisSinceLaunch();
+std::wstring        DefaultLogDir();
+std::string         WideToUtf8(const std::wstring& text);
+std::wstring        Utf8ToWide(const std::string& text);
+std::wstring        GetControlText(HWND hControl);
 
 int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPWSTR lpCmdLine, _In_ int nCmdShow)
 {
+    int argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if (argv && argc > 1 && wcscmp(argv[1], L"--query") == 0) {
+        int exitCode = RunQueryCommand(argc, argv);
+        LocalFree(argv);
+        return exitCode;
+    }
+    if (argv && argc > 1 && wcscmp(argv[1], L"--export") == 0) {
+        int exitCode = RunExportCommand(argc, argv);
+        LocalFree(argv);
+        return exitCode;
+    }
+    if (argv && argc > 1 && wcscmp(argv[1], L"--merge") == 0) {
+        int exitCode = RunMergeCommand(argc, argv);
+        LocalFree(argv);
+        return exitCode;
+    }
+    if (argv && argc > 1 && wcscmp(argv[1], L"--headless") == 0) {
+        int exitCode = RunHeadlessCommand(argc, argv);
+        LocalFree(argv);
+        return exitCode;
+    }
+    if (argv) LocalFree(argv);
     srand((unsigned int)time(NULL));
     INITCOMMONCONTROLSEX icex;
     icex.dwSize = sizeof(INITCOMMONCONTROLSEX);
@@ -105,6 +267,14 @@ ATOM MyRegisterClass(HINSTANCE hInstance)
     wcex.hbrBackground = g_brBackground;
     wcex.lpszClassName = szWindowClass;
     wcex.hIconSm = LoadIcon(wcex.hInstance, MAKEINTRESOURCE(IDI_SMALL));
+    WNDCLASSEXW wcexQuery = wcex;
+    wcexQuery.lpfnWndProc = QueryWndProc;
+    wcexQuery.lpszClassName = L"SerialMonitorQuery";
+    RegisterClassExW(&wcexQuery);
+    WNDCLASSEXW wcexMerge = wcex;
+    wcexMerge.lpfnWndProc = MergeWndProc;
+    wcexMerge.lpszClassName = L"SerialMonitorMerge";
+    RegisterClassExW(&wcexMerge);
     return RegisterClassExW(&wcex);
 }
 
@@ -126,11 +296,32 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
     {
     case WM_PAINT: {
         PAINTSTRUCT ps;
-        HDC hdc = BeginPaint(hWnd, &ps);
-        DrawAnimationFrame(); // Redraw the animation canvas
+        BeginPaint(hWnd, &ps);
         EndPaint(hWnd, &ps);
         break;
     }
+    case WM_DRAWITEM: {
+        LPDRAWITEMSTRUCT dis = (LPDRAWITEMSTRUCT)lParam;
+        if (dis->hwndItem != hAnimationCanvas) break;
+        if (!g_animCache.hdcBack) return TRUE;
+        LARGE_INTEGER startTicks, endTicks;
+        QueryPerformanceCounter(&startTicks);
+        BitBlt(dis->hDC, 0, 0, ANIMATION_WIDTH, ANIMATION_HEIGHT, g_animCache.hdcBack, 0, 0, SRCCOPY);
+        GdiFlush(); // GDI batches calls; time the copy itself, not just queuing it
+        QueryPerformanceCounter(&endTicks);
+        uint64_t ticks = g_animStats.pendingTicks + (uint64_t)(endTicks.QuadPart - startTicks.QuadPart);
+        g_animStats.pendingTicks = 0;
+        g_animStats.frames++;
+        g_animStats.totalTicks += ticks;
+        if (ticks > g_animStats.maxTicks) g_animStats.maxTicks = ticks;
+        return TRUE;
+    }
+    case WM_WTSSESSION_CHANGE: {
+        if (wParam == WTS_SESSION_LOCK || wParam == WTS_REMOTE_DISCONNECT) g_animSessionHidden = true;
+        else if (wParam == WTS_SESSION_UNLOCK || wParam == WTS_REMOTE_CONNECT) g_animSessionHidden = false;
+        UpdateAnimationTimer(hWnd);
+        break;
+    }
     case WM_CTLCOLORSTATIC: {
         HDC hdcStatic = (HDC)wParam;
         if ((HWND)lParam == hAnimationCanvas) {
@@ -168,7 +359,7 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
                 ListView_GetSubItemRect(hOutputListView, iItem, 1, LVIR_LABEL, &subItemRect);
                 ListView_GetItemText(hOutputListView, iItem, 1, text, sizeof(text) / sizeof(wchar_t));
                 FillRect(hdc, &subItemRect, g_brBackground);
-                SetTextColor(hdc, RGB(0, 255, 0));
+                SetTextColor(hdc, (COLORREF)lplvcd->nmcd.lItemlParam);
                 subItemRect.left += 4;
                 DrawTextW(hdc, text, -1, &subItemRect, DT_LEFT | DT_VCENTER | DT_SINGLELINE | DT_NOPREFIX);
                 return CDRF_DODEFAULT;
@@ -188,20 +379,71 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
         EnableWindow(hStopButton, TRUE);
         ShowWindow(hCancelButton, SW_HIDE);
         g_animState = AS_ANIMATING_IDLE;
-        SetTimer(hWnd, IDT_ANIMATION_TIMER, 400, NULL);
+        UpdateAnimationTimer(hWnd);
         break;
     }
     case WM_SERIAL_DATA_RECEIVED: {
-        if (g_animState == AS_ANIMATING_IDLE) {
-            SetTimer(hWnd, IDT_ANIMATION_TIMER, 250, NULL);
+        // Slow the animation down while rows are queuing up faster than we add them
+        LONG backlog = InterlockedDecrement(&g_uiBacklog);
+        bool throttled = g_animThrottled ? backlog > 32 : backlog > 256;
+        if (g_animState != AS_ANIMATING_ACTIVE || throttled != g_animThrottled) {
+            g_animState = AS_ANIMATING_ACTIVE;
+            g_animThrottled = throttled;
+            UpdateAnimationTimer(hWnd);
         }
-        g_animState = AS_ANIMATING_ACTIVE;
         SetTimer(hWnd, IDT_WATCHDOG_TIMER, 1000, NULL);
         LogEntry* entry = (LogEntry*)wParam;
         AddLogEntry(entry);
         delete entry;
         break;
     }
+    case WM_LINE_FOLDED: {
+        // The row may have been trimmed or cleared since; then the update is dropped
+        FoldUpdate* update = (FoldUpdate*)wParam;
+        auto row = std::lower_bound(g_scrollback.begin(), g_scrollback.end(), update->rowId,
+            [](const LogEntry& e, uint64_t id) { return e.rowId < id; });
+        if (row != g_scrollback.end() && row->rowId == update->rowId) {
+            row->repeats = update->count;
+            row->lastRepeatMs = update->lastMs;
+            static TimestampFormatter formatter;
+            wchar_t repeats[64];
+            swprintf_s(repeats, L"x%u  last %hs", update->count, formatter.Format(update->lastMs).substr(11).c_str());
+            ListView_SetItemText(hOutputListView, (int)(row - g_scrollback.begin()), 2, repeats);
+        }
+        delete update;
+        break;
+    }
+    case WM_PORTS_ENUMERATED: {
+        // Keep the current (profile) port selected even if it is not plugged in
+        std::vector<std::wstring>* ports = (std::vector<std::wstring>*)wParam;
+        wchar_t current[32];
+        GetWindowTextW(hPortCombo, current, 32);
+        SendMessageW(hPortCombo, CB_RESETCONTENT, 0, 0);
+        for (const std::wstring& port : *ports) SendMessageW(hPortCombo, CB_ADDSTRING, 0, (LPARAM)port.c_str());
+        if (current[0] != L'\0') SelectOrAddComboString(hPortCombo, current);
+        else SendMessageW(hPortCombo, CB_SETCURSEL, 0, 0);
+        delete ports;
+        break;
+    }
+    case WM_QUERY_DONE: {
+        QueryJob* job = (QueryJob*)wParam;
+        g_queryRunning = false;
+        EnableWindow(hQueryButton, TRUE);
+        ShowQueryResults(hWnd, job);
+        delete job;
+        break;
+    }
+    case WM_MERGE_DONE: {
+        MergeJob* job = (MergeJob*)wParam;
+        if (job != g_mergeJob) break;   // already joined and freed by CancelMerge
+        WaitForSingleObject(g_hMergeThread, INFINITE);
+        CloseHandle(g_hMergeThread);
+        g_hMergeThread = NULL;
+        g_mergeJob = nullptr;
+        ShowMergeResults(hWnd, job);
+        delete job;
+        break;
+    }
     case WM_UPDATE_STATUS: {
         wchar_t* status = (wchar_t*)wParam;
         SetWindowTextW(hStatusLabel, status);
@@ -219,7 +461,7 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
         EnableWindow(hStopButton, FALSE);
         ShowWindow(hCancelButton, SW_SHOW);
         g_animState = AS_IDLE;
-        KillTimer(hWnd, IDT_ANIMATION_TIMER);
+        UpdateAnimationTimer(hWnd);
         KillTimer(hWnd, IDT_WATCHDOG_TIMER);
         DrawAnimationFrame();
         break;
@@ -236,17 +478,43 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
         case IDT_WATCHDOG_TIMER:
             KillTimer(hWnd, IDT_WATCHDOG_TIMER);
             g_animState = AS_ANIMATING_IDLE;
-            SetTimer(hWnd, IDT_ANIMATION_TIMER, 400, NULL);
+            UpdateAnimationTimer(hWnd);
             break;
+        case IDT_EXPORT_TIMER: {
+            wchar_t status[128];
+            if (!g_exportJob.Finished()) {
+                int permille = g_exportJob.Status().permille;
+                wsprintfW(status, L"Exporting... %d.%d%%", permille / 10, permille % 10);
+                SetWindowTextW(hStatusLabel, status);
+                break;
+            }
+            KillTimer(hWnd, IDT_EXPORT_TIMER);
+            std::string error;
+            uint64_t rows;
+            if (g_exportJob.Collect(error, rows)) {
+                swprintf_s(status, L"Exported %llu rows.", (unsigned long long)rows);
+                SetWindowTextW(hStatusLabel, status);
+            }
+            else {
+                SetWindowTextW(hStatusLabel, (L"Export failed: " + Utf8ToWide(error)).c_str());
+            }
+            break;
+        }
         }
         break;
     }
-    case WM_CREATE: CreateControls(hWnd); break;
+    case WM_CREATE:
+        CreateControls(hWnd);
+        CreateAnimationCache(hWnd);
+        WTSRegisterSessionNotification(hWnd, NOTIFY_FOR_THIS_SESSION);
+        break;
     case WM_SIZE: {
+        UpdateAnimationTimer(hWnd); // Suspended while minimized
+        if (wParam == SIZE_MINIMIZED) break;
         int newWidth = LOWORD(lParam);
         int newHeight = HIWORD(lParam);
-        MoveWindow(hOutputListView, 10, 130, newWidth - 20, newHeight - 170, TRUE);
-        ListView_SetColumnWidth(hOutputListView, 1, newWidth - 125);
+        MoveWindow(hOutputListView, 10, 193, newWidth - 20, newHeight - 233, TRUE);
+        ListView_SetColumnWidth(hOutputListView, 1, newWidth - 295);
         MoveWindow(hStatusLabel, 10, newHeight - 35, 200, 25, TRUE);
         MoveWindow(hCancelButton, 220, newHeight - 35, 140, 25, TRUE);
         MoveWindow(hAnimationCanvas, newWidth - (ANIMATION_WIDTH + 20), 10, ANIMATION_WIDTH, ANIMATION_HEIGHT, TRUE);
@@ -258,7 +526,57 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
         case IDC_STOP_BUTTON:    StopMonitoring(); break;
         case IDC_CANCEL_BUTTON:  StopMonitoring(); break;
         case IDC_REFRESH_BUTTON: PopulatePorts(); break;
-        case IDC_CLEAR_BUTTON:   ListView_DeleteAllItems(hOutputListView); break;
+        case IDC_CLEAR_BUTTON:   ListView_DeleteAllItems(hOutputListView); g_scrollback.clear(); break;
+        case IDC_EXPORT_BUTTON: {
+            if (g_exportJob.Running()) {
+                g_exportJob.Cancel();
+                break;
+            }
+            RECT rc;
+            GetWindowRect(hExportButton, &rc);
+            HMENU hMenu = CreatePopupMenu();
+            AppendMenuW(hMenu, MF_STRING, IDM_EXPORT_SCROLLBACK, L"Export scrollback...");
+            AppendMenuW(hMenu, MF_STRING, IDM_EXPORT_CAPTURE, L"Export capture file...");
+            AppendMenuW(hMenu, MF_SEPARATOR, 0, NULL);
+            AppendMenuW(hMenu, MF_STRING, IDM_MERGE_CAPTURES, g_mergeJob ? L"Stop merge" : L"Merge captures...");
+            TrackPopupMenu(hMenu, TPM_LEFTALIGN | TPM_TOPALIGN, rc.left, rc.bottom, 0, hWnd, NULL);
+            DestroyMenu(hMenu);
+            break;
+        }
+        case IDC_QUERY_BUTTON:      StartQuery(hWnd); break;
+        case IDC_ANIMATION_CANVAS: {
+            if (HIWORD(wParam) != STN_CLICKED) break;
+            LARGE_INTEGER freq;
+            QueryPerformanceFrequency(&freq);
+            double usPerTick = 1e6 / (double)freq.QuadPart;
+            wchar_t status[128];
+            swprintf_s(status, L"Animation: %llu frames, avg %.0f us, max %.0f us%s", (unsigned long long)g_animStats.frames,
+                g_animStats.frames ? g_animStats.totalTicks * usPerTick / g_animStats.frames : 0.0,
+                g_animStats.maxTicks * usPerTick, g_animThrottled ? L" (throttled)" : L"");
+            SetWindowTextW(hStatusLabel, status);
+            break;
+        }
+        case IDC_PROFILE_COMBO:
+            if (HIWORD(wParam) == CBN_SELCHANGE) {
+                int sel = (int)SendMessageW(hProfileCombo, CB_GETCURSEL, 0, 0);
+                wchar_t name[80];
+                if (sel != CB_ERR && SendMessageW(hProfileCombo, CB_GETLBTEXTLEN, sel, 0) < 80) {
+                    SendMessageW(hProfileCombo, CB_GETLBTEXT, sel, (LPARAM)name);
+                    LoadProfileByName(hWnd, name);
+                }
+            }
+            break;
+        case IDC_PROFILE_SAVE: SaveCurrentProfile(hWnd); break;
+        case IDC_PROFILE_EDIT: EditCurrentProfile(hWnd); break;
+        case IDC_FOLD_COMBO:
+            if (HIWORD(wParam) == CBN_SELCHANGE) g_foldMode = (LONG)SendMessageW(hFoldCombo, CB_GETCURSEL, 0, 0);
+            break;
+        case IDM_EXPORT_SCROLLBACK: StartExport(hWnd, false); break;
+        case IDM_EXPORT_CAPTURE:    StartExport(hWnd, true); break;
+        case IDM_MERGE_CAPTURES:
+            if (g_mergeJob) CancelMerge(false);
+            else StartMerge(hWnd);
+            break;
         case IDC_BROWSE_BUTTON: {
             BROWSEINFOW bi = { 0 };
             bi.lpszTitle = L"Select a folder to save logs";
@@ -278,10 +596,15 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
     }
     case WM_CLOSE:
         SaveSettings();
+        g_exportJob.Cancel();
+        CancelMerge(true);
         StopMonitoring();
         DestroyWindow(hWnd);
         break;
     case WM_DESTROY:
+        CancelMerge(true);
+        WTSUnRegisterSessionNotification(hWnd);
+        DestroyAnimationCache();
         DeleteObject(g_hMonoFont);
         PostQuitMessage(0);
         break;
@@ -304,22 +627,40 @@ void CreateControls(HWND hWnd)
     CreateWindowW(L"STATIC", L"Log Folder:", WS_CHILD | WS_VISIBLE, 10, 80, 80, 20, hWnd, NULL, hInst, NULL);
     hLogDirEdit = CreateWindowW(L"EDIT", L"", WS_CHILD | WS_VISIBLE | WS_BORDER | ES_AUTOHSCROLL, 100, 75, 410, 25, hWnd, (HMENU)IDC_LOGDIR_EDIT, hInst, NULL);
     hBrowseButton = CreateWindowW(L"BUTTON", L"...", WS_CHILD | WS_VISIBLE, 520, 75, 30, 25, hWnd, (HMENU)IDC_BROWSE_BUTTON, hInst, NULL);
+    hExportButton = CreateWindowW(L"BUTTON", L"Export", WS_CHILD | WS_VISIBLE, 555, 75, 60, 25, hWnd, (HMENU)IDC_EXPORT_BUTTON, hInst, NULL);
     hStartButton = CreateWindowW(L"BUTTON", L"Start", WS_CHILD | WS_VISIBLE, 400, 10, 110, 25, hWnd, (HMENU)IDC_START_BUTTON, hInst, NULL);
     hStopButton = CreateWindowW(L"BUTTON", L"Stop", WS_CHILD | WS_VISIBLE, 400, 40, 110, 25, hWnd, (HMENU)IDC_STOP_BUTTON, hInst, NULL);
     hClearButton = CreateWindowW(L"BUTTON", L"Clear Output", WS_CHILD | WS_VISIBLE, 520, 10, 95, 55, hWnd, (HMENU)IDC_CLEAR_BUTTON, hInst, NULL);
+    CreateWindowW(L"STATIC", L"Triggers:", WS_CHILD | WS_VISIBLE, 10, 106, 80, 20, hWnd, NULL, hInst, NULL);
+    hTriggerEdit = CreateWindowW(L"EDIT", L"", WS_CHILD | WS_VISIBLE | WS_BORDER | ES_AUTOHSCROLL, 100, 103, 300, 22, hWnd, (HMENU)IDC_TRIGGER_EDIT, hInst, NULL);
+    CreateWindowW(L"STATIC", L"Share:", WS_CHILD | WS_VISIBLE, 410, 106, 45, 20, hWnd, NULL, hInst, NULL);
+    hShareEdit = CreateWindowW(L"EDIT", L"", WS_CHILD | WS_VISIBLE | WS_BORDER | ES_AUTOHSCROLL, 460, 103, 155, 22, hWnd, (HMENU)IDC_SHARE_EDIT, hInst, NULL);
+    CreateWindowW(L"STATIC", L"Find in Logs:", WS_CHILD | WS_VISIBLE, 10, 136, 85, 20, hWnd, NULL, hInst, NULL);
+    hQueryEdit = CreateWindowW(L"EDIT", L"", WS_CHILD | WS_VISIBLE | WS_BORDER | ES_AUTOHSCROLL, 100, 133, 250, 22, hWnd, (HMENU)IDC_QUERY_EDIT, hInst, NULL);
+    CreateWindowW(L"STATIC", L"Fold:", WS_CHILD | WS_VISIBLE, 360, 136, 40, 20, hWnd, NULL, hInst, NULL);
+    hFoldCombo = CreateWindowW(WC_COMBOBOXW, L"", CBS_DROPDOWNLIST | WS_CHILD | WS_VISIBLE | WS_VSCROLL, 400, 132, 110, 100, hWnd, (HMENU)IDC_FOLD_COMBO, hInst, NULL);
+    hQueryButton = CreateWindowW(L"BUTTON", L"Search", WS_CHILD | WS_VISIBLE, 520, 131, 95, 25, hWnd, (HMENU)IDC_QUERY_BUTTON, hInst, NULL);
 
-    hAnimationCanvas = CreateWindowW(L"STATIC", L"", WS_CHILD | WS_VISIBLE | SS_OWNERDRAW, 640, 10, ANIMATION_WIDTH, ANIMATION_HEIGHT, hWnd, (HMENU)IDC_ANIMATION_CANVAS, hInst, NULL);
+    CreateWindowW(L"STATIC", L"Profile:", WS_CHILD | WS_VISIBLE, 10, 166, 85, 20, hWnd, NULL, hInst, NULL);
+    hProfileCombo = CreateWindowW(WC_COMBOBOXW, L"", CBS_DROPDOWN | CBS_AUTOHSCROLL | CBS_SORT | WS_CHILD | WS_VISIBLE | WS_VSCROLL, 100, 162, 250, 200, hWnd, (HMENU)IDC_PROFILE_COMBO, hInst, NULL);
+    hProfileSaveButton = CreateWindowW(L"BUTTON", L"Save", WS_CHILD | WS_VISIBLE, 360, 161, 70, 25, hWnd, (HMENU)IDC_PROFILE_SAVE, hInst, NULL);
+    hProfileEditButton = CreateWindowW(L"BUTTON", L"Edit...", WS_CHILD | WS_VISIBLE, 440, 161, 70, 25, hWnd, (HMENU)IDC_PROFILE_EDIT, hInst, NULL);
 
-    hOutputListView = CreateWindowExW(0, WC_LISTVIEWW, L"", WS_CHILD | WS_VISIBLE | WS_BORDER | LVS_REPORT, 10, 130, 920, 400, hWnd, (HMENU)IDC_OUTPUT_EDIT, hInst, NULL);
+    hAnimationCanvas = CreateWindowW(L"STATIC", L"", WS_CHILD | WS_VISIBLE | SS_OWNERDRAW | SS_NOTIFY, 640, 10, ANIMATION_WIDTH, ANIMATION_HEIGHT, hWnd, (HMENU)IDC_ANIMATION_CANVAS, hInst, NULL);
+
+    hOutputListView = CreateWindowExW(0, WC_LISTVIEWW, L"", WS_CHILD | WS_VISIBLE | WS_BORDER | LVS_REPORT, 10, 193, 920, 340, hWnd, (HMENU)IDC_OUTPUT_EDIT, hInst, NULL);
     ListView_SetBkColor(hOutputListView, RGB(0, 0, 0));
     LVCOLUMNW lvc = { 0 };
     lvc.mask = LVCF_TEXT | LVCF_WIDTH | LVCF_SUBITEM;
     lvc.cx = 100;
     lvc.pszText = (LPWSTR)L"Time";
     ListView_InsertColumn(hOutputListView, 0, &lvc);
-    lvc.cx = 815;
+    lvc.cx = 645;
     lvc.pszText = (LPWSTR)L"Message";
     ListView_InsertColumn(hOutputListView, 1, &lvc);
+    lvc.cx = 170;
+    lvc.pszText = (LPWSTR)L"Repeats";
+    ListView_InsertColumn(hOutputListView, 2, &lvc);
     ListView_SetExtendedListViewStyle(hOutputListView, LVS_EX_FULLROWSELECT | LVS_EX_DOUBLEBUFFER);
 
     hStatusLabel = CreateWindowW(L"STATIC", L"Ready.", WS_CHILD | WS_VISIBLE, 10, 545, 450, 20, hWnd, (HMENU)IDC_STATUS_LABEL, hInst, NULL);
@@ -332,9 +673,18 @@ void CreateControls(HWND hWnd)
     SetWindowTheme(hStopButton, L"Explorer", NULL);
     SetWindowTheme(hBrowseButton, L"Explorer", NULL);
     SetWindowTheme(hLogDirEdit, L"Explorer", NULL);
+    SetWindowTheme(hTriggerEdit, L"Explorer", NULL);
+    SetWindowTheme(hShareEdit, L"Explorer", NULL);
     SetWindowTheme(hCancelButton, L"Explorer", NULL);
     SetWindowTheme(hOutputListView, L"Explorer", NULL);
     SetWindowTheme(hClearButton, L"Explorer", NULL);
+    SetWindowTheme(hExportButton, L"Explorer", NULL);
+    SetWindowTheme(hQueryEdit, L"Explorer", NULL);
+    SetWindowTheme(hQueryButton, L"Explorer", NULL);
+    SetWindowTheme(hFoldCombo, L"Explorer", NULL);
+    SetWindowTheme(hProfileCombo, L"Explorer", NULL);
+    SetWindowTheme(hProfileSaveButton, L"Explorer", NULL);
+    SetWindowTheme(hProfileEditButton, L"Explorer", NULL);
     HWND hHeader = ListView_GetHeader(hOutputListView);
     SetWindowTheme(hHeader, L"Explorer", NULL);
 
@@ -342,133 +692,247 @@ void CreateControls(HWND hWnd)
     ShowWindow(hCancelButton, SW_HIDE);
     std::vector<std::string> bauds = { "9600", "57600", "115200", "250000", "921600" };
     for (const auto& r : bauds) SendMessageA(hBaudCombo, CB_ADDSTRING, 0, (LPARAM)r.c_str());
+    SendMessageW(hFoldCombo, CB_ADDSTRING, 0, (LPARAM)L"Off");
+    SendMessageW(hFoldCombo, CB_ADDSTRING, 0, (LPARAM)L"Identical");
+    SendMessageW(hFoldCombo, CB_ADDSTRING, 0, (LPARAM)L"Same template");
+    SendMessageW(hFoldCombo, CB_SETCURSEL, FOLD_OFF, 0);
     PopulatePorts();
     LoadSettings();
 }
 
-void DrawAnimationFrame()
-{
-    // Cat Sprites
-    const wchar_t* catIdle1 = LR"EOF(
+// Cat Sprites
+static const wchar_t* catFrames[] = {
+    LR"EOF(
    /\_/\
   ( o.o )
   > ^ <
 --(,,)-(,,)--
-)EOF";
-    const wchar_t* catIdle2 = LR"EOF(
+)EOF",
+    LR"EOF(
    /\_/\
   ( o.o )
   > ^ <
 --(,,)-(,,)--  ~
-)EOF";
-    const wchar_t* catIdle3 = LR"EOF(
+)EOF",
+    LR"EOF(
    /\_/\
   ( o.o )
   > ^ <
 --(,,)-(,,)--   ~
-)EOF";
-    const wchar_t* catIdle4 = LR"EOF(
+)EOF",
+    LR"EOF(
    /\_/\
   ( o.o )
   > ^ <
 --(,,)-(,,)--    ~
-)EOF";
-    const wchar_t* catActive1 = LR"EOF(
+)EOF",
+    LR"EOF(
       /\_/\
      ( o.o )
      > ^ <
     ( (")" ) )
-)EOF";
-    const wchar_t* catActive2 = LR"EOF(
+)EOF",
+    LR"EOF(
       /\_/\
      ( -.- )
      > ^ <
     ( (")" ) )
-)EOF";
+)EOF"
+};
+static const wchar_t* waterFrames[] = {
+    L"    --__--__--__--    ",
+    L"   --__--__--__--_    ",
+    L"  _--__--__--__--__   ",
+    L" --__--__--__--__-   "
+};
+static const wchar_t* fishFrames[] = {
+    LR"EOF(><((('>  )EOF",
+    LR"EOF( <')))<>< )EOF",
+    LR"EOF( ,.'o)<   )EOF"
+};
+static const COLORREF fishColors[] = {
+    RGB(255, 255, 0),   // Yellow
+    RGB(255, 192, 203), // Pink
+    RGB(255, 0, 0),     // Red
+    RGB(128, 0, 128),   // Purple
+    RGB(255, 100, 100)  // Original reddish
+};
 
-    const wchar_t* waterFrames[] = {
-        L"    --__--__--__--    ",
-        L"   --__--__--__--_    ",
-        L"  _--__--__--__--__   ",
-        L" --__--__--__--__-   "
-    };
-    const wchar_t* fishFrames[] = {
-        LR"EOF(><((('>  )EOF",
-        LR"EOF( <')))<>< )EOF",
-        LR"EOF( ,.'o)<   )EOF"
-    };
+// --- Animation Control Variables ---
+// ADJUST this value (0.0 to 1.0) to change the water width.
+static const float water_width_percentage = 0.52f;
+// ADJUST this value to change fish frequency. Lower = more fish.
+static const int fish_spawn_chance = 8; // Represents a 1 in X chance to spawn per frame
+static const int water_y_start = 60;
+static const int water_x_left_padding = 30;
+static const int water_x_offsets[] = { 0, 5, -3, 2 };
+static const int sprite_line_height = 12;
 
-    HDC hdc = GetDC(hAnimationCanvas);
-    HDC hdcMem = CreateCompatibleDC(hdc);
-    HBITMAP hbm = CreateCompatibleBitmap(hdc, ANIMATION_WIDTH, ANIMATION_HEIGHT);
-    SelectObject(hdcMem, hbm);
+// Draws a multi-line sprite at (x, y) (or only measures it when hdc is NULL) and returns its bounds.
+static RECT RenderSprite(HDC hdc, HDC hdcMeasure, int x, int y, const std::wstring& text, COLORREF color)
+{
+    RECT bounds = { x, y, x, y };
+    if (hdc) SetTextColor(hdc, color);
+    size_t start = 0;
+    int lineY = y;
+    for (;;) {
+        size_t end = text.find(L'\n', start);
+        size_t len = (end == std::wstring::npos ? text.size() : end) - start;
+        SIZE extent = { 0, 0 };
+        GetTextExtentPoint32W(hdcMeasure, text.c_str() + start, (int)len, &extent);
+        if (hdc) TextOutW(hdc, x, lineY, text.c_str() + start, (int)len);
+        bounds.right = max(bounds.right, x + (int)extent.cx);
+        bounds.bottom = lineY + max((int)extent.cy, sprite_line_height);
+        if (end == std::wstring::npos) break;
+        start = end + 1;
+        lineY += sprite_line_height;
+    }
+    return bounds;
+}
 
-    RECT rc = { 0, 0, ANIMATION_WIDTH, ANIMATION_HEIGHT };
-    FillRect(hdcMem, &rc, g_brBackground);
+// Water rows are the trimmed pattern repeated to fill the water width.
+static std::wstring BuildWaterLine(const wchar_t* frame)
+{
+    std::wstring pattern = frame;
+    size_t first = pattern.find_first_not_of(L' ');
+    if (first == std::wstring::npos) return std::wstring();
+    pattern = pattern.substr(first, pattern.find_last_not_of(L' ') - first + 1);
+    int water_width = (int)(ANIMATION_WIDTH * water_width_percentage);
+    std::wstring line;
+    while ((int)line.length() * 8 < water_width) line += pattern;
+    return line;
+}
+
+// Renders every sprite variant once, stacked vertically in the atlas.
+void CreateAnimationCache(HWND hWnd)
+{
+    HDC hdc = GetDC(hWnd);
+    AnimationCache& c = g_animCache;
+    c.hdcAtlas = CreateCompatibleDC(hdc);
+    c.hdcBack = CreateCompatibleDC(hdc);
+    HGDIOBJ oldFont = SelectObject(c.hdcAtlas, g_hMonoFont);
+
+    std::wstring waterLines[4];
+    for (int p = 0; p < 4; p++) waterLines[p] = BuildWaterLine(waterFrames[p]);
+
+    // Two passes: measure to size the atlas, then draw
+    int atlasWidth = 0, atlasHeight = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        HDC target = pass == 0 ? NULL : c.hdcAtlas;
+        int y = 0;
+        for (int i = 0; i < 6; i++) {
+            c.cat[i] = RenderSprite(target, c.hdcAtlas, 0, y, catFrames[i], RGB(0, 255, 0));
+            y = c.cat[i].bottom;
+        }
+        for (int i = 0; i < 8; i++) {
+            c.water[i] = RenderSprite(target, c.hdcAtlas, 0, y, waterLines[i / 2], (i % 2 == 0) ? RGB(0, 80, 200) : RGB(50, 150, 255));
+            y = c.water[i].bottom;
+        }
+        for (int i = 0; i < 15; i++) {
+            c.fish[i] = RenderSprite(target, c.hdcAtlas, 0, y, fishFrames[i / 5], fishColors[i % 5]);
+            y = c.fish[i].bottom;
+        }
+        if (pass == 0) {
+            for (const RECT& r : c.cat) atlasWidth = max(atlasWidth, (int)r.right);
+            for (const RECT& r : c.water) atlasWidth = max(atlasWidth, (int)r.right);
+            for (const RECT& r : c.fish) atlasWidth = max(atlasWidth, (int)r.right);
+            atlasHeight = y;
+            c.hbmAtlas = CreateCompatibleBitmap(hdc, atlasWidth, atlasHeight);
+            c.oldAtlas = SelectObject(c.hdcAtlas, c.hbmAtlas);
+            RECT all = { 0, 0, atlasWidth, atlasHeight };
+            FillRect(c.hdcAtlas, &all, g_brBackground);
+            SetBkMode(c.hdcAtlas, TRANSPARENT);
+        }
+    }
+    SelectObject(c.hdcAtlas, oldFont);
+
+    // Monochrome mask of the atlas: pixels matching the background colour (black)
+    // become 1, glyph pixels 0
+    c.hdcMask = CreateCompatibleDC(hdc);
+    c.hbmMask = CreateBitmap(atlasWidth, atlasHeight, 1, 1, NULL);
+    c.oldMask = SelectObject(c.hdcMask, c.hbmMask);
+    SetBkColor(c.hdcAtlas, RGB(0, 0, 0));
+    BitBlt(c.hdcMask, 0, 0, atlasWidth, atlasHeight, c.hdcAtlas, 0, 0, SRCCOPY);
+
+    c.hbmBack = CreateCompatibleBitmap(hdc, ANIMATION_WIDTH, ANIMATION_HEIGHT);
+    c.oldBack = SelectObject(c.hdcBack, c.hbmBack);
+    // Mask 1 bits expand to white and 0 bits to black when blitted into the back buffer
+    SetBkColor(c.hdcBack, RGB(255, 255, 255));
+    SetTextColor(c.hdcBack, RGB(0, 0, 0));
+    ReleaseDC(hWnd, hdc);
+    DrawAnimationFrame();
+}
 
-    HFONT hOldFont = (HFONT)SelectObject(hdcMem, g_hMonoFont);
-    SetBkMode(hdcMem, TRANSPARENT);
+void DestroyAnimationCache()
+{
+    AnimationCache& c = g_animCache;
+    if (c.hdcAtlas) {
+        SelectObject(c.hdcAtlas, c.oldAtlas);
+        DeleteObject(c.hbmAtlas);
+        DeleteDC(c.hdcAtlas);
+    }
+    if (c.hdcMask) {
+        SelectObject(c.hdcMask, c.oldMask);
+        DeleteObject(c.hbmMask);
+        DeleteDC(c.hdcMask);
+    }
+    if (c.hdcBack) {
+        SelectObject(c.hdcBack, c.oldBack);
+        DeleteObject(c.hbmBack);
+        DeleteDC(c.hdcBack);
+    }
+    c = AnimationCache();
+}
+
+// Picks the timer period for the current state. The timer is stopped while
+// idle, minimized or in a locked/disconnected session, and slowed to 1s while
+// the serial thread is ahead of the UI.
+void UpdateAnimationTimer(HWND hWnd)
+{
+    UINT interval = g_animState == AS_IDLE ? 0 : g_animState == AS_ANIMATING_ACTIVE ? 250 : 400;
+    if (interval && g_animThrottled) interval = 1000;
+    if (IsIconic(hWnd) || g_animSessionHidden) interval = 0;
+    if (interval == g_animInterval) return;
+    g_animInterval = interval;
+    if (interval) SetTimer(hWnd, IDT_ANIMATION_TIMER, interval, NULL);
+    else KillTimer(hWnd, IDT_ANIMATION_TIMER);
+}
+
+// Pastes a pre-rendered sprite with a transparent background. The mask first
+// clears the sprite's glyph pixels, then OR-ing the atlas fills them, so a fish
+// overwrites the water under it instead of mixing colours with it.
+static void BlitSprite(HDC hdc, const RECT& sprite, int x, int y)
+{
+    int width = sprite.right - sprite.left, height = sprite.bottom - sprite.top;
+    BitBlt(hdc, x, y, width, height, g_animCache.hdcMask, sprite.left, sprite.top, SRCAND);
+    BitBlt(hdc, x, y, width, height, g_animCache.hdcAtlas, sprite.left, sprite.top, SRCPAINT);
+}
 
-    const wchar_t* catFrame;
+void DrawAnimationFrame()
+{
+    if (!g_animCache.hdcBack) return;
+    LARGE_INTEGER startTicks, endTicks;
+    QueryPerformanceCounter(&startTicks);
+    HDC hdcMem = g_animCache.hdcBack;
+    PatBlt(hdcMem, 0, 0, ANIMATION_WIDTH, ANIMATION_HEIGHT, BLACKNESS);
 
+    int catFrame;
     if (g_animState == AS_IDLE) {
-        int frame = g_animFrame % 4;
-        if (frame == 0) catFrame = catIdle1;
-        else if (frame == 1) catFrame = catIdle2;
-        else if (frame == 2) catFrame = catIdle3;
-        else catFrame = catIdle4;
+        catFrame = g_animFrame % 4;
     }
     else {
         int frame = g_animFrame % 16;
-        catFrame = (frame < 15) ? catActive1 : catActive2;
+        catFrame = (frame < 15) ? 4 : 5;
     }
-
     // Draw the centered cat
-    std::wstringstream ss_cat(catFrame);
-    std::wstring line;
-    int y_cat = 0;
-    SetTextColor(hdcMem, RGB(0, 255, 0));
-    while (std::getline(ss_cat, line)) {
-        TextOutW(hdcMem, (ANIMATION_WIDTH / 2) - 80, y_cat, line.c_str(), (int)line.length());
-        y_cat += 12;
-    }
+    BlitSprite(hdcMem, g_animCache.cat[catFrame], (ANIMATION_WIDTH / 2) - 80, 0);
 
     // Water and Fish logic (only appears when not idle)
     if (g_animState != AS_IDLE) {
-        // --- Animation Control Variables ---
-        // ADJUST this value (0.0 to 1.0) to change the water width.
-        float water_width_percentage = 0.52f;
-        // ADJUST this value to change fish frequency. Lower = more fish.
-        int fish_spawn_chance = 8; // Represents a 1 in X chance to spawn per frame
-
-        int water_y_start = 60;
-        int water_x_left_padding = 30;
-        int water_width = (int)(ANIMATION_WIDTH * water_width_percentage);
-        int x_offsets[] = { 0, 5, -3, 2 };
-
-        // Draw 4 lines of water.
+        // Draw 4 lines of water, each with its own left offset.
         for (int i = 0; i < 4; ++i) {
-            std::wstring waterPattern = waterFrames[(g_animFrame + i) % 4];
-
-            // Trim spaces from the pattern.
-            size_t first = waterPattern.find_first_not_of(L' ');
-            if (std::wstring::npos != first) {
-                size_t last = waterPattern.find_last_not_of(L' ');
-                waterPattern = waterPattern.substr(first, (last - first + 1));
-            }
-
-            std::wstring fullWaterLine;
-            if (!waterPattern.empty()) {
-                // Repeat pattern to fill the width.
-                while (wcslen(fullWaterLine.c_str()) * 8 < water_width) {
-                    fullWaterLine += waterPattern;
-                }
-            }
-
-            SetTextColor(hdcMem, (i % 2 == 0) ? RGB(0, 80, 200) : RGB(50, 150, 255));
-            // Apply the unique offset for each line to stagger the left edge.
-            int current_x = water_x_left_padding + x_offsets[i];
-            TextOutW(hdcMem, current_x, water_y_start + (i * 12), fullWaterLine.c_str(), (int)fullWaterLine.length());
+            int pattern = (g_animFrame + i) % 4;
+            BlitSprite(hdcMem, g_animCache.water[pattern * 2 + i % 2], water_x_left_padding + water_x_offsets[i], water_y_start + (i * 12));
         }
 
         if (!g_fish.is_swimming && rand() % fish_spawn_chance == 0) {
@@ -476,29 +940,12 @@ void DrawAnimationFrame()
             g_fish.lifespan = 80 + rand() % 30;
             g_fish.x = -40;
             g_fish.y = water_y_start + 12 + (rand() % 36);
-            g_fish.sprite = fishFrames[rand() % 3];
-
-            // Define a color palette and pick a random color for the new fish
-            const std::vector<COLORREF> fish_colors = {
-                RGB(255, 255, 0),   // Yellow
-                RGB(255, 192, 203), // Pink
-                RGB(255, 0, 0),     // Red
-                RGB(128, 0, 128),   // Purple
-                RGB(255, 100, 100)  // Original reddish
-            };
-            g_fish.color = fish_colors[rand() % fish_colors.size()];
+            g_fish.sprite = rand() % 3;
+            g_fish.color = rand() % 5;
         }
 
         if (g_fish.is_swimming) {
-            // Use the fish's stored color
-            SetTextColor(hdcMem, g_fish.color);
-            std::wstringstream fish_ss(g_fish.sprite);
-            std::wstring fish_line;
-            int fish_y = g_fish.y;
-            while (std::getline(fish_ss, fish_line)) {
-                TextOutW(hdcMem, g_fish.x, fish_y, fish_line.c_str(), (int)fish_line.length());
-                fish_y += 12;
-            }
+            BlitSprite(hdcMem, g_animCache.fish[g_fish.sprite * 5 + g_fish.color], g_fish.x, g_fish.y);
             g_fish.x += 4;
             g_fish.lifespan--;
             if (g_fish.lifespan <= 0 || g_fish.x > ANIMATION_WIDTH) {
@@ -507,22 +954,20 @@ void DrawAnimationFrame()
         }
     }
 
-    BitBlt(hdc, 0, 0, ANIMATION_WIDTH, ANIMATION_HEIGHT, hdcMem, 0, 0, SRCCOPY);
-    SelectObject(hdcMem, hOldFont);
-
-    DeleteObject(hbm);
-    DeleteDC(hdcMem);
-    ReleaseDC(hAnimationCanvas, hdc);
+    InvalidateRect(hAnimationCanvas, NULL, FALSE);
     g_animFrame++;
+    QueryPerformanceCounter(&endTicks);
+    // Counted as a frame once WM_DRAWITEM has put it on screen
+    g_animStats.pendingTicks += (uint64_t)(endTicks.QuadPart - startTicks.QuadPart);
 }
 
 void StopMonitoring()
 {
     HWND hWnd = GetParent(hStartButton);
     KillTimer(hWnd, IDT_RECONNECT_TIMER);
-    KillTimer(hWnd, IDT_ANIMATION_TIMER);
     KillTimer(hWnd, IDT_WATCHDOG_TIMER);
     g_animState = AS_IDLE;
+    UpdateAnimationTimer(hWnd);
     DrawAnimationFrame();
     if (bShouldBeMonitoring) {
         bShouldBeMonitoring = false;
@@ -532,188 +977,422 @@ void StopMonitoring()
             hThread = NULL;
         }
     }
+    g_streamServer.Stop();
     SetWindowTextW(hStatusLabel, L"Stopped.");
     EnableWindow(hStartButton, TRUE);
     EnableWindow(hStopButton, FALSE);
     ShowWindow(hCancelButton, SW_HIDE);
 }
 
+// Probing COM1-COM255 is slow enough to hold up window creation, so it runs
+// on a worker thread and the list comes back via WM_PORTS_ENUMERATED.
 void PopulatePorts()
 {
-    SendMessageW(hPortCombo, CB_RESETCONTENT, 0, 0);
+    HANDLE hEnumThread = CreateThread(NULL, 0, PortEnumThread, GetParent(hPortCombo), 0, NULL);
+    if (hEnumThread != NULL) CloseHandle(hEnumThread);
+}
+
+DWORD WINAPI PortEnumThread(LPVOID lpParam)
+{
+    std::vector<std::wstring>* ports = new std::vector<std::wstring>();
     wchar_t targetPath[255];
     wchar_t comName[32];
     for (int i = 1; i < 256; i++) {
         wsprintfW(comName, L"COM%d", i);
-        if (QueryDosDeviceW(comName, targetPath, 255) != 0) {
-            SendMessageW(hPortCombo, CB_ADDSTRING, 0, (LPARAM)comName);
-        }
+        if (QueryDosDeviceW(comName, targetPath, 255) != 0) ports->push_back(comName);
     }
-    SendMessageW(hPortCombo, CB_SETCURSEL, 0, 0);
+    if (!PostMessageW((HWND)lpParam, WM_PORTS_ENUMERATED, (WPARAM)ports, 0)) delete ports;
+    return 0;
+}
+
+void SelectOrAddComboString(HWND hCombo, const std::wstring& text)
+{
+    LRESULT index = SendMessageW(hCombo, CB_FINDSTRINGEXACT, (WPARAM)-1, (LPARAM)text.c_str());
+    if (index == CB_ERR) index = SendMessageW(hCombo, CB_ADDSTRING, 0, (LPARAM)text.c_str());
+    SendMessageW(hCombo, CB_SETCURSEL, index, 0);
 }
 
 void StartMonitoring(HWND hWnd)
 {
     if (hThread != NULL) return;
     KillTimer(hWnd, IDT_RECONNECT_TIMER);
+    if (!g_streamServer.Running()) {
+        StreamServerConfig shareConfig;
+        std::string shareError;
+        if (!ParseShareSpec(WideToUtf8(GetControlText(hShareEdit)), shareConfig, shareError) ||
+            (!shareConfig.Empty() && !g_streamServer.Start(shareConfig, shareError))) {
+            MessageBoxW(hWnd, Utf8ToWide(shareError).c_str(), L"Share", MB_OK | MB_ICONWARNING);
+        }
+    }
+    SerialSession* session = new SerialSession();
+    session->hWnd = hWnd;
+    session->profile = g_profile;
+    ReadProfileFromControls(session->profile);
     bShouldBeMonitoring = true;
     PostMessage(hWnd, WM_GUI_STATE_CONNECTING, 0, 0);
-    hThread = CreateThread(NULL, 0, SerialThread, hWnd, 0, NULL);
+    hThread = CreateThread(NULL, 0, SerialThread, session, 0, NULL);
+    if (hThread == NULL) delete session;
 }
 
-DWORD WINAPI SerialThread(LPVOID lpParam)
+// Posts each line as a row; repeats fold at this display stage only, so the log
+// file, captures and share streams still see every line.
+class WindowSink : public SerialSink {
+public:
+    WindowSink(HWND hWnd, const SessionProfile& profile) : m_hWnd(hWnd), m_profile(profile) {}
+    bool KeepReading() override { return bShouldBeMonitoring; }
+    void OnStatus(const std::wstring& text) override { PostStatus(m_hWnd, text); }
+    void OnLines(uint64_t readTime, std::vector<std::string>& lines) override;
+    void OnTick() override;
+private:
+    HWND m_hWnd;
+    const SessionProfile& m_profile;
+    LineFolder m_folder;
+    bool m_foldPending = false;
+    uint64_t m_lastRowId = 0;   // the row the current run folds into
+    TimestampFormatter m_formatter;
+};
+
+void WindowSink::OnLines(uint64_t readTime, std::vector<std::string>& lines)
 {
-    HWND hWnd = (HWND)lpParam;
-    HANDLE hSerial = INVALID_HANDLE_VALUE;
-    HANDLE hLogFile = INVALID_HANDLE_VALUE;
+    char stamp[TIMESTAMP_LEN];
+    m_formatter.Format(readTime, stamp);
+    m_folder.SetMode((FoldMode)g_foldMode);
+    for (std::string& message : lines) {
+        uint32_t runCount = m_folder.Count();
+        uint64_t runLastMs = m_folder.LastMs();
+        if (m_folder.Add(readTime, message.data(), message.length())) {
+            m_foldPending = true;
+            continue;
+        }
+        if (m_foldPending) {
+            PostMessageW(m_hWnd, WM_LINE_FOLDED, (WPARAM)new FoldUpdate{ m_lastRowId, runCount, runLastMs }, 0);
+            m_foldPending = false;
+        }
+        LogEntry* entry = new LogEntry();
+        entry->rowId = m_lastRowId = (uint64_t)InterlockedIncrement64(&g_nextRowId);
+        entry->timeMs = readTime;
+        entry->timestamp.assign(stamp + 11, stamp + TIMESTAMP_LEN);   // HH:MM:SS.mmm
+        // Rules match the received text, not its hex rendering
+        uint32_t rgb = HighlightColor(m_profile, message, 0x00FF00);
+        if (m_profile.decoder != DECODER_TEXT) message = DecodeForDisplay(m_profile, message);
+        entry->color = RGB((rgb >> 16) & 0xFF, (rgb >> 8) & 0xFF, rgb & 0xFF);
+        entry->message = Utf8ToWide(message);
+        InterlockedIncrement(&g_uiBacklog);
+        if (!PostMessageW(m_hWnd, WM_SERIAL_DATA_RECEIVED, (WPARAM)entry, 0)) {
+            InterlockedDecrement(&g_uiBacklog);
+            delete entry;
+        }
+    }
+}
 
-    wchar_t portW[32], baudW[16], logDirW[MAX_PATH];
-    GetWindowTextW(hPortCombo, portW, 32);
-    GetWindowTextW(hBaudCombo, baudW, 16);
-    GetWindowTextW(hLogDirEdit, logDirW, MAX_PATH);
-    std::wstring fullPortName = L"\\\\.\\" + std::wstring(portW);
+// At most one count update per 100 ms for a run that is still going
+void WindowSink::OnTick()
+{
+    if (!m_foldPending) return;
+    PostMessageW(m_hWnd, WM_LINE_FOLDED, (WPARAM)new FoldUpdate{ m_lastRowId, m_folder.Count(), m_folder.LastMs() }, 0);
+    m_foldPending = false;
+}
+
+DWORD WINAPI SerialThread(LPVOID lpParam)
+{
+    SerialSession* session = (SerialSession*)lpParam;
+    HWND hWnd = session->hWnd;
+    const SessionProfile profile = session->profile;
+    delete session;
+    std::wstring portW = Utf8ToWide(profile.port);
 
     wchar_t status[128];
-    wsprintfW(status, L"Connecting to %s...", portW);
+    wsprintfW(status, L"Connecting to %s...", portW.c_str());
     wchar_t* statusMsg = new wchar_t[128];
     wcscpy_s(statusMsg, 128, status);
     PostMessageW(hWnd, WM_UPDATE_STATUS, (WPARAM)statusMsg, 0);
 
-    hSerial = CreateFileW(fullPortName.c_str(), GENERIC_READ | GENERIC_WRITE, 0, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
-
+    std::wstring warning;
+    HANDLE hSerial = OpenSerialPort(profile, warning);
     if (hSerial == INVALID_HANDLE_VALUE) {
         PostMessage(hWnd, WM_CONNECTION_LOST, 0, 0);
         return 1;
     }
 
+    PostMessage(hWnd, WM_GUI_STATE_CONNECTED, 0, 0);
+    wsprintfW(status, L"✅ Connected to %s", portW.c_str());
+    PostStatus(hWnd, warning.empty() ? std::wstring(status) : std::wstring(status) + L" (" + warning + L")");
+
+    WindowSink sink(hWnd, profile);
+    if (!RunSerialReader(hSerial, profile, sink)) PostMessage(hWnd, WM_CONNECTION_LOST, 0, 0);
+    CloseHandle(hSerial);
+    return 0;
+}
+
+// Shared by the window and --headless. Reads until the sink stops it, or returns
+// false when the port fails. Raw bytes go to the log, the trigger capture and the
+// share stream; every line completed by a read is stamped with that read's time.
+bool RunSerialReader(HANDLE hSerial, const SessionProfile& profile, SerialSink& sink)
+{
+    HANDLE hLogFile = OpenLogFile(profile);
+    uint64_t logBytes = 0;
+
+    // Trigger captures keep a bounded raw ring and write fault windows to their own files
+    TriggerCapture capture;
+    TriggerConfig triggerConfig;
+    std::string triggerError;
+    if (!ParseTriggerSpec(profile.triggers, triggerConfig, triggerError)) {
+        sink.OnStatus(L"Triggers disabled: " + Utf8ToWide(triggerError));
+    }
+    else {
+        capture.Configure(triggerConfig, WideToUtf8(ProfileLogDir(profile) + L"\\capture_" + Utf8ToWide(profile.port)));
+    }
+    std::string captureEvent;
+    std::string shareCommands;
+    const char delimiter = profile.LineDelimiter();
+
+    std::string dataBuffer;
+    std::vector<std::string> lines;
+    ULONGLONG lastTickTime = GetTickCount64();
+    char readBuf[4096];
+    DWORD bytesRead;
+    bool ok = true;
+
+    while (sink.KeepReading()) {
+        if (!ReadFile(hSerial, readBuf, sizeof(readBuf), &bytesRead, NULL)) {
+            ok = false;
+            break;
+        }
+        if (bytesRead > 0) {
+            if (InterlockedExchange(&g_firstByteReported, 1) == 0) {
+                wchar_t firstByte[96];
+                swprintf_s(firstByte, L"First byte received %.0f ms after launch", MillisSinceLaunch());
+                sink.OnStatus(firstByte);
+            }
+            uint64_t readTime = NowMillis();
+            capture.OnData(readTime, readBuf, bytesRead);
+            g_streamServer.PublishRaw(readBuf, bytesRead);
+            WriteRawLog(profile, hLogFile, logBytes, readBuf, bytesRead);
+
+            dataBuffer.append(readBuf, bytesRead);
+            lines.clear();
+            size_t start = 0, newline_pos;
+            while ((newline_pos = dataBuffer.find(delimiter, start)) != std::string::npos) {
+                lines.push_back(dataBuffer.substr(start, newline_pos + 1 - start));
+                g_streamServer.PublishLine(readTime, lines.back().data(), lines.back().length());
+                start = newline_pos + 1;
+            }
+            dataBuffer.erase(0, start);
+            if (!lines.empty()) sink.OnLines(readTime, lines);
+        }
+        else if (capture.Enabled()) {
+            capture.OnIdle(NowMillis());
+        }
+        while (capture.TakeEvent(captureEvent)) sink.OnStatus(Utf8ToWide(captureEvent));
+        // Write-through from shared clients goes out between reads
+        if (g_streamServer.TakeCommands(shareCommands)) {
+            DWORD bytesWritten;
+            WriteFile(hSerial, shareCommands.data(), (DWORD)shareCommands.size(), &bytesWritten, NULL);
+        }
+
+        if (GetTickCount64() - lastTickTime > 100) {
+            sink.OnTick();
+            if (hLogFile != INVALID_HANDLE_VALUE) FlushFileBuffers(hLogFile);
+            lastTickTime = GetTickCount64();
+        }
+    }
+
+    capture.Close();
+    while (capture.TakeEvent(captureEvent)) sink.OnStatus(Utf8ToWide(captureEvent));
+    if (hLogFile != INVALID_HANDLE_VALUE) CloseHandle(hLogFile);
+    return ok;
+}
+
+// Opens the port with the profile's line settings. Settings the driver rejects
+// are reported in warning and the port is used as the driver left it.
+HANDLE OpenSerialPort(const SessionProfile& profile, std::wstring& warning)
+{
+    std::wstring fullPortName = L"\\\\.\\" + Utf8ToWide(profile.port);
+    HANDLE hSerial = CreateFileW(fullPortName.c_str(), GENERIC_READ | GENERIC_WRITE, 0, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (hSerial == INVALID_HANDLE_VALUE) return hSerial;
+
     DCB dcb = { 0 };
     dcb.DCBlength = sizeof(dcb);
     if (GetCommState(hSerial, &dcb)) {
-        dcb.BaudRate = _wtoi(baudW);
-        dcb.ByteSize = 8;
-        dcb.Parity = NOPARITY;
-        dcb.StopBits = ONESTOPBIT;
-        dcb.fDtrControl = DTR_CONTROL_ENABLE;
-        SetCommState(hSerial, &dcb);
+        dcb.BaudRate = profile.baud;
+        dcb.ByteSize = profile.dataBits;
+        dcb.Parity = (BYTE)profile.parity; // ProfileParity matches NOPARITY..SPACEPARITY
+        dcb.fParity = profile.parity != PAR_NONE;
+        dcb.StopBits = (BYTE)profile.stopBits; // ProfileStopBits matches ONESTOPBIT..TWOSTOPBITS
+        dcb.fOutxCtsFlow = profile.flow == FLOW_RTSCTS;
+        dcb.fRtsControl = profile.flow == FLOW_RTSCTS ? RTS_CONTROL_HANDSHAKE : RTS_CONTROL_ENABLE;
+        dcb.fOutxDsrFlow = profile.flow == FLOW_DTRDSR;
+        dcb.fDtrControl = profile.flow == FLOW_DTRDSR ? DTR_CONTROL_HANDSHAKE : DTR_CONTROL_ENABLE;
+        dcb.fOutX = dcb.fInX = profile.flow == FLOW_XONXOFF;
+        if (!SetCommState(hSerial, &dcb)) warning = L"line settings rejected by the driver";
     }
+    // The 50 ms total timeout governs: every read returns within 50 ms with
+    // whatever arrived, possibly nothing, so the reader loops keep running
+    // silence triggers, post windows, write-through and stop requests on a
+    // quiet port. The interval timeout is moot, since it is longer than that.
     COMMTIMEOUTS timeouts = { 0 };
     timeouts.ReadIntervalTimeout = 100;
+    timeouts.ReadTotalTimeoutConstant = 50;
     SetCommTimeouts(hSerial, &timeouts);
-    EscapeCommFunction(hSerial, CLRDTR); Sleep(100);
-    EscapeCommFunction(hSerial, SETDTR); Sleep(500);
+    if (profile.dtrReset && profile.flow != FLOW_DTRDSR) {
+        EscapeCommFunction(hSerial, CLRDTR); Sleep(100);
+        EscapeCommFunction(hSerial, SETDTR); Sleep(500);
+    }
+    return hSerial;
+}
 
-    PostMessage(hWnd, WM_GUI_STATE_CONNECTED, 0, 0);
-    wsprintfW(status, L"✅ Connected to %s", portW);
-    statusMsg = new wchar_t[128];
-    wcscpy_s(statusMsg, 128, status);
-    PostMessageW(hWnd, WM_UPDATE_STATUS, (WPARAM)statusMsg, 0);
+std::wstring ProfileLogDir(const SessionProfile& profile)
+{
+    if (!profile.logDir.empty()) return Utf8ToWide(profile.logDir);
+    wchar_t buffer[MAX_PATH] = L"";
+    SHGetFolderPathW(NULL, CSIDL_MYDOCUMENTS, NULL, 0, buffer);
+    return buffer;
+}
 
+// New raw log file for the profile's port, or INVALID_HANDLE_VALUE when logging is off.
+HANDLE OpenLogFile(const SessionProfile& profile)
+{
+    if (!profile.logEnabled) return INVALID_HANDLE_VALUE;
     SYSTEMTIME st;
     GetLocalTime(&st);
     wchar_t logFileName[MAX_PATH];
-    wsprintfW(logFileName, L"%s\\log_%s_%04d-%02d-%02d_%02d-%02d-%02d.txt", logDirW, portW, st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond);
-    hLogFile = CreateFileW(logFileName, FILE_APPEND_DATA, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    swprintf_s(logFileName, L"%s\\log_%s_%04d-%02d-%02d_%02d-%02d-%02d.txt", ProfileLogDir(profile).c_str(),
+        Utf8ToWide(profile.port).c_str(), st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond);
+    return CreateFileW(logFileName, FILE_APPEND_DATA, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+}
 
-    std::string dataBuffer;
-    ULONGLONG lastUpdateTime = GetTickCount64();
-    ULONGLONG lastDataReceivedTime = GetTickCount64();
-    char readBuf[512];
-    DWORD bytesRead;
+// Appends to the raw log and rolls over to a new file at log_rotate_mb.
+void WriteRawLog(const SessionProfile& profile, HANDLE& hLogFile, uint64_t& logBytes, const char* data, DWORD len)
+{
+    if (hLogFile == INVALID_HANDLE_VALUE) return;
+    DWORD written = 0;
+    WriteFile(hLogFile, data, len, &written, NULL);
+    logBytes += written;
+    if (profile.logRotateMb != 0 && logBytes >= ((uint64_t)profile.logRotateMb << 20)) {
+        CloseHandle(hLogFile);
+        hLogFile = OpenLogFile(profile);
+        logBytes = 0;
+    }
+}
 
-    while (bShouldBeMonitoring) {
-        if (ReadFile(hSerial, readBuf, sizeof(readBuf), &bytesRead, NULL)) {
-            if (bytesRead > 0) {
-                dataBuffer.append(readBuf, bytesRead);
-                if (hLogFile != INVALID_HANDLE_VALUE) WriteFile(hLogFile, readBuf, bytesRead, &bytesRead, NULL);
-                lastDataReceivedTime = GetTickCount64();
-            }
-        }
-        else {
-            PostMessage(hWnd, WM_CONNECTION_LOST, 0, 0);
-            break;
-        }
+// Process creation to now, for the cold start to first byte measurement.
+double MillisSinceLaunch()
+{
+    FILETIME created, exited, kernel, user, now;
+    if (!GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) return 0;
+    GetSystemTimePreciseAsFileTime(&now);
+    ULARGE_INTEGER start, end;
+    start.LowPart = created.dwLowDateTime;
+    start.HighPart = created.dwHighDateTime;
+    end.LowPart = now.dwLowDateTime;
+    end.HighPart = now.dwHighDateTime;
+    return (double)(end.QuadPart - start.QuadPart) / 10000.0;
+}
 
-        if (GetTickCount64() - lastUpdateTime > 100) {
-            size_t newline_pos;
-            while ((newline_pos = dataBuffer.find('\n')) != std::string::npos)
-            {
-                std::string message = dataBuffer.substr(0, newline_pos + 1);
-                dataBuffer.erase(0, newline_pos + 1);
-                LogEntry* entry = new LogEntry();
-                SYSTEMTIME st_now;
-                GetLocalTime(&st_now);
-                wchar_t timeBuf[32];
-                wsprintfW(timeBuf, L"%02d:%02d:%02d.%03d", st_now.wHour, st_now.wMinute, st_now.wSecond, st_now.wMilliseconds);
-                entry->timestamp = timeBuf;
-                wchar_t* wideBuf = new wchar_t[message.length() + 1];
-                MultiByteToWideChar(CP_UTF8, 0, message.c_str(), -1, wideBuf, static_cast<int>(message.length() + 1));
-                entry->message = wideBuf;
-                delete[] wideBuf;
-                PostMessageW(hWnd, WM_SERIAL_DATA_RECEIVED, (WPARAM)entry, 0);
-            }
-            if (hLogFile != INVALID_HANDLE_VALUE) FlushFileBuffers(hLogFile);
-            lastUpdateTime = GetTickCount64();
-        }
+void PostStatus(HWND hWnd, const std::wstring& text)
+{
+    wchar_t* statusMsg = new wchar_t[text.length() + 1];
+    wcscpy_s(statusMsg, text.length() + 1, text.c_str());
+    PostMessageW(hWnd, WM_UPDATE_STATUS, (WPARAM)statusMsg, 0);
+}
 
-        // WATCHDOG: Check for silence
-        if (GetTickCount64() - lastDataReceivedTime > 1000) {
-            // Post a status message to the GUI
-            wchar_t* resetMsg = new wchar_t[128];
-            wsprintfW(resetMsg, L"Device silent. Forcing full reconnect...");
-            PostMessageW(hWnd, WM_UPDATE_STATUS, (WPARAM)resetMsg, 0);
+std::string WideToUtf8(const std::wstring& text)
+{
+    if (text.empty()) return std::string();
+    int len = WideCharToMultiByte(CP_UTF8, 0, text.c_str(), (int)text.length(), NULL, 0, NULL, NULL);
+    std::string out(len, '\0');
+    WideCharToMultiByte(CP_UTF8, 0, text.c_str(), (int)text.length(), &out[0], len, NULL, NULL);
+    return out;
+}
 
-            // Break the inner loop to trigger a full close/re-open of the port
-            PostMessage(hWnd, WM_CONNECTION_LOST, 0, 0);
-            break;
-        }
-    }
+std::wstring Utf8ToWide(const std::string& text)
+{
+    if (text.empty()) return std::wstring();
+    int len = MultiByteToWideChar(CP_UTF8, 0, text.c_str(), (int)text.length(), NULL, 0);
+    std::wstring out(len, L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, text.c_str(), (int)text.length(), &out[0], len);
+    return out;
+}
 
-    if (hSerial != INVALID_HANDLE_VALUE) CloseHandle(hSerial);
-    if (hLogFile != INVALID_HANDLE_VALUE) CloseHandle(hLogFile);
-    return 0;
+// Whole text of an edit or combo box; trigger and share specs have no length limit.
+std::wstring GetControlText(HWND hControl)
+{
+    std::wstring text(GetWindowTextLengthW(hControl) + 1, L'\0');
+    text.resize(GetWindowTextW(hControl, &text[0], (int)text.size()));
+    return text;
+}
+
+// REG_SZ value of any length.
+static bool ReadRegString(HKEY hKey, const wchar_t* name, std::wstring& value)
+{
+    DWORD size = 0;
+    if (RegQueryValueExW(hKey, name, NULL, NULL, NULL, &size) != ERROR_SUCCESS) return false;
+    std::wstring buffer(size / sizeof(wchar_t) + 1, L'\0');
+    if (RegQueryValueExW(hKey, name, NULL, NULL, (LPBYTE)&buffer[0], &size) != ERROR_SUCCESS) return false;
+    value = buffer.c_str();
+    return true;
 }
 
+// Session settings live only in profile files: the named profile when one is
+// loaded, otherwise LastSession.smprofile. The registry keeps which profile that
+// was and a copy of the log folder, the default folder of --query.
 void SaveSettings()
 {
+    std::wstring name = GetControlText(hProfileCombo);
+    if (!IsValidProfileName(WideToUtf8(name)) || GetFileAttributesW(ProfilePath(name).c_str()) == INVALID_FILE_ATTRIBUTES) {
+        name.clear();
+        ReadProfileFromControls(g_profile);
+        SHCreateDirectoryExW(NULL, ProfilesDir().c_str(), NULL);
+        std::string error;
+        SaveProfileFile(WideToUtf8(SessionProfilePath()), g_profile, error);
+    }
     HKEY hKey;
-    RegCreateKeyExW(HKEY_CURRENT_USER, L"Software\\CppSerialMonitor", 0, NULL, 0, KEY_WRITE, NULL, &hKey, NULL);
-    wchar_t buffer[MAX_PATH];
-    GetWindowTextW(hPortCombo, buffer, 32);
-    RegSetValueExW(hKey, L"LastPort", 0, REG_SZ, (BYTE*)buffer, static_cast<DWORD>((wcslen(buffer) + 1) * sizeof(wchar_t)));
-    GetWindowTextW(hBaudCombo, buffer, 16);
-    RegSetValueExW(hKey, L"LastBaud", 0, REG_SZ, (BYTE*)buffer, static_cast<DWORD>((wcslen(buffer) + 1) * sizeof(wchar_t)));
-    GetWindowTextW(hLogDirEdit, buffer, MAX_PATH);
-    RegSetValueExW(hKey, L"LastLogDir", 0, REG_SZ, (BYTE*)buffer, static_cast<DWORD>((wcslen(buffer) + 1) * sizeof(wchar_t)));
+    if (RegCreateKeyExW(HKEY_CURRENT_USER, L"Software\\CppSerialMonitor", 0, NULL, 0, KEY_WRITE, NULL, &hKey, NULL) != ERROR_SUCCESS) return;
+    std::wstring logDir = GetControlText(hLogDirEdit);
+    RegSetValueExW(hKey, L"LastLogDir", 0, REG_SZ, (BYTE*)logDir.c_str(), static_cast<DWORD>((logDir.length() + 1) * sizeof(wchar_t)));
+    RegSetValueExW(hKey, L"LastProfile", 0, REG_SZ, (BYTE*)name.c_str(), static_cast<DWORD>((name.length() + 1) * sizeof(wchar_t)));
+    // Written by older versions; the session file replaces them
+    for (const wchar_t* legacy : { L"LastPort", L"LastBaud", L"Triggers", L"Share", L"FoldMode" }) RegDeleteValueW(hKey, legacy);
+    RegCloseKey(hKey);
+}
+
+// Settings older versions kept in the registry, used until the first session file is saved.
+static void ReadLegacySettings(SessionProfile& profile)
+{
+    HKEY hKey;
+    if (RegOpenKeyExW(HKEY_CURRENT_USER, L"Software\\CppSerialMonitor", 0, KEY_READ, &hKey) != ERROR_SUCCESS) return;
+    std::wstring text;
+    if (ReadRegString(hKey, L"LastPort", text)) profile.port = WideToUtf8(text);
+    if (ReadRegString(hKey, L"LastBaud", text) && _wtoi(text.c_str()) > 0) profile.baud = (uint32_t)_wtoi(text.c_str());
+    if (ReadRegString(hKey, L"LastLogDir", text)) profile.logDir = WideToUtf8(text);
+    if (ReadRegString(hKey, L"Triggers", text)) profile.triggers = WideToUtf8(text);
+    if (ReadRegString(hKey, L"Share", text)) profile.share = WideToUtf8(text);
+    DWORD foldMode = 0, foldSize = sizeof(foldMode);
+    if (RegQueryValueExW(hKey, L"FoldMode", NULL, NULL, (LPBYTE)&foldMode, &foldSize) == ERROR_SUCCESS && foldMode <= FOLD_TEMPLATE) {
+        profile.foldMode = (int)foldMode;
+    }
     RegCloseKey(hKey);
 }
 
+// The last named profile wins; without one (or if it no longer loads) the last session is restored.
 void LoadSettings()
 {
+    std::wstring lastProfile;
     HKEY hKey;
-    if (RegOpenKeyExW(HKEY_CURRENT_USER, L"Software\\CppSerialMonitor", 0, KEY_READ, &hKey) == ERROR_SUCCESS)
-    {
-        wchar_t buffer[MAX_PATH];
-        DWORD bufferSize = sizeof(buffer);
-        if (RegQueryValueExW(hKey, L"LastPort", NULL, NULL, (LPBYTE)buffer, &bufferSize) == ERROR_SUCCESS) {
-            SendMessageW(hPortCombo, CB_SELECTSTRING, -1, (LPARAM)buffer);
-        }
-        bufferSize = sizeof(buffer);
-        if (RegQueryValueExW(hKey, L"LastBaud", NULL, NULL, (LPBYTE)buffer, &bufferSize) == ERROR_SUCCESS) {
-            SendMessageW(hBaudCombo, CB_SELECTSTRING, -1, (LPARAM)buffer);
-        }
-        else {
-            SendMessageW(hBaudCombo, CB_SELECTSTRING, -1, (LPARAM)L"250000");
-        }
-        bufferSize = sizeof(buffer);
-        if (RegQueryValueExW(hKey, L"LastLogDir", NULL, NULL, (LPBYTE)buffer, &bufferSize) == ERROR_SUCCESS) {
-            SetWindowTextW(hLogDirEdit, buffer);
-        }
-        else {
-            SHGetFolderPathW(NULL, CSIDL_MYDOCUMENTS, NULL, 0, buffer);
-            SetWindowTextW(hLogDirEdit, buffer);
-        }
+    if (RegOpenKeyExW(HKEY_CURRENT_USER, L"Software\\CppSerialMonitor", 0, KEY_READ, &hKey) == ERROR_SUCCESS) {
+        ReadRegString(hKey, L"LastProfile", lastProfile);
         RegCloseKey(hKey);
     }
+    RefreshProfileList();
+    if (!lastProfile.empty() && LoadProfileByName(GetParent(hProfileCombo), lastProfile)) return;
+
+    SessionProfile profile;
+    std::string error;
+    if (GetFileAttributesW(SessionProfilePath().c_str()) == INVALID_FILE_ATTRIBUTES) ReadLegacySettings(profile);
+    else if (!LoadProfileFile(WideToUtf8(SessionProfilePath()), profile, error)) profile = SessionProfile();
+    profile.autoConnect = false;
+    g_profile = profile;
+    ApplyProfileToControls(profile);
 }
 
 void AddLogEntry(const LogEntry* entry)
@@ -722,13 +1401,15 @@ void AddLogEntry(const LogEntry* entry)
     LRESULT itemCount = ListView_GetItemCount(hOutputListView);
     if (itemCount >= MAX_ITEMS) {
         ListView_DeleteItem(hOutputListView, 0);
+        if (!g_scrollback.empty()) g_scrollback.pop_front();
     }
     itemCount = ListView_GetItemCount(hOutputListView);
     LVITEMW lvi = { 0 };
-    lvi.mask = LVIF_TEXT;
+    lvi.mask = LVIF_TEXT | LVIF_PARAM;
     lvi.iItem = (int)itemCount;
     lvi.iSubItem = 0;
     lvi.pszText = (LPWSTR)entry->timestamp.c_str();
+    lvi.lParam = (LPARAM)entry->color;
     LRESULT newIndex = ListView_InsertItem(hOutputListView, &lvi);
     std::wstring normalizedMessage = entry->message;
     size_t pos = 0;
@@ -750,4 +1431,724 @@ void AddLogEntry(const LogEntry* entry)
     }
     ListView_SetItemText(hOutputListView, (int)newIndex, 1, (LPWSTR)normalizedMessage.c_str());
     ListView_EnsureVisible(hOutputListView, (int)newIndex, FALSE);
-}
\ No newline at end of file
+    g_scrollback.push_back(*entry);
+    g_scrollback.back().message = normalizedMessage;
+}
+
+// Asks for the source (capture file) and target, then exports on a worker thread.
+void StartExport(HWND hWnd, bool fromCapture)
+{
+    ExportRequest request;
+    wchar_t path[MAX_PATH] = L"";
+    wchar_t logDirW[MAX_PATH];
+    GetWindowTextW(hLogDirEdit, logDirW, MAX_PATH);
+    OPENFILENAMEW ofn = { 0 };
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = hWnd;
+    ofn.lpstrFile = path;
+    ofn.nMaxFile = MAX_PATH;
+    ofn.lpstrInitialDir = logDirW;
+    if (fromCapture) {
+        ofn.lpstrFilter = L"Capture files (capture_*.txt)\0capture_*.txt\0All files\0*.*\0";
+        ofn.Flags = OFN_FILEMUSTEXIST | OFN_PATHMUSTEXIST;
+        if (!GetOpenFileNameW(&ofn)) return;
+        request.sourcePath = WideToUtf8(path);
+    }
+    else {
+        // A folded row keeps its repeat count and last time in the exported text
+        TimestampFormatter formatter;
+        for (const LogEntry& row : g_scrollback) {
+            std::string text = WideToUtf8(row.message);
+            if (row.repeats > 1) {
+                char repeats[64];
+                snprintf(repeats, sizeof(repeats), "  [x%u, last %s]", row.repeats, formatter.Format(row.lastRepeatMs).substr(11).c_str());
+                text += repeats;
+            }
+            request.lines.push_back({ row.timeMs, text });
+        }
+    }
+
+    path[0] = L'\0';
+    ofn.lpstrFilter = L"CSV\0*.csv\0JSON Lines\0*.jsonl\0Columnar\0*.smcol\0";
+    ofn.nFilterIndex = 1;
+    ofn.lpstrDefExt = L"csv";
+    ofn.Flags = OFN_OVERWRITEPROMPT | OFN_PATHMUSTEXIST;
+    if (!GetSaveFileNameW(&ofn)) return;
+    request.targetPath = WideToUtf8(path);
+    request.format = ofn.nFilterIndex == 2 ? EF_JSONL : ofn.nFilterIndex == 3 ? EF_COLUMNAR : EF_CSV;
+
+    if (g_exportJob.Start(std::move(request))) {
+        SetWindowTextW(hStatusLabel, L"Exporting...");
+        SetTimer(hWnd, IDT_EXPORT_TIMER, 250, NULL);
+    }
+}
+
+static bool HasStdHandle(DWORD which)
+{
+    HANDLE h = GetStdHandle(which);
+    return h != NULL && h != INVALID_HANDLE_VALUE && GetFileType(h) != FILE_TYPE_UNKNOWN;
+}
+
+// Console for the command-line modes. A stream the parent already redirected
+// to a file or pipe keeps its handle; only streams without one are pointed at
+// CONOUT$. The check runs before attaching, since attaching can hand out
+// console handles that the CRT streams of a GUI process are not bound to.
+void AttachCommandConsole()
+{
+    bool hasOut = HasStdHandle(STD_OUTPUT_HANDLE);
+    bool hasErr = HasStdHandle(STD_ERROR_HANDLE);
+    if (!AttachConsole(ATTACH_PARENT_PROCESS)) AllocConsole();
+    FILE* stream = nullptr;
+    if (!hasOut) freopen_s(&stream, "CONOUT$", "w", stdout);
+    if (!hasErr) freopen_s(&stream, "CONOUT$", "w", stderr);
+    SetConsoleOutputCP(CP_UTF8);
+}
+
+// SerialMonitor.exe --export <capture.txt> <out.csv|out.jsonl|out.smcol> [--from <time>] [--to <time>]
+// Times are local "YYYY-MM-DD HH:MM:SS[.mmm]"; both ends of the range are inclusive.
+int RunExportCommand(int argc, LPWSTR* argv)
+{
+    AttachCommandConsole();
+
+    ExportRequest request;
+    bool badArgs = false;
+    for (int i = 2; i < argc && !badArgs; i++) {
+        std::wstring arg = argv[i];
+        if ((arg == L"--from" || arg == L"--to") && i + 1 < argc) {
+            bool from = arg == L"--from";
+            std::string value = WideToUtf8(argv[++i]);
+            if (!ParseExportTime(value, !from, from ? request.fromMs : request.toMs)) {
+                printf("error: bad time \"%s\", expected YYYY-MM-DD HH:MM:SS[.mmm]\n", value.c_str());
+                return 2;
+            }
+        }
+        else if (request.sourcePath.empty()) request.sourcePath = WideToUtf8(arg);
+        else if (request.targetPath.empty()) request.targetPath = WideToUtf8(arg);
+        else badArgs = true;
+    }
+    if (badArgs || request.sourcePath.empty() || request.targetPath.empty()) {
+        printf("usage: SerialMonitor --export <capture.txt> <out.csv|out.jsonl|out.smcol> [--from <time>] [--to <time>]\n");
+        return 2;
+    }
+    if (request.fromMs > request.toMs) {
+        printf("error: --from is after --to\n");
+        return 2;
+    }
+    request.format = ExportFormatForPath(request.targetPath);
+
+    ExportStatus status;
+    if (!RunExport(request, status)) {
+        printf("error: %s\n", status.error.c_str());
+        return 1;
+    }
+    printf("%llu rows exported to %s\n", (unsigned long long)status.rows.load(), request.targetPath.c_str());
+    fflush(stdout);
+    return 0;
+}
+
+// Runs a log folder query on a worker thread. A leading "re:" makes the
+// pattern a regular expression; searches are case-insensitive in the GUI.
+void StartQuery(HWND hWnd)
+{
+    if (g_queryRunning) return;
+    wchar_t patternW[512], logDirW[MAX_PATH];
+    GetWindowTextW(hQueryEdit, patternW, 512);
+    GetWindowTextW(hLogDirEdit, logDirW, MAX_PATH);
+    QueryJob* job = new QueryJob();
+    job->hWnd = hWnd;
+    job->folder = WideToUtf8(logDirW);
+    job->options.pattern = WideToUtf8(patternW);
+    job->options.ignoreCase = true;
+    if (job->options.pattern.compare(0, 3, "re:") == 0) {
+        job->options.pattern.erase(0, 3);
+        job->options.regex = true;
+    }
+    if (job->options.pattern.empty()) {
+        delete job;
+        return;
+    }
+    HANDLE hQueryThread = CreateThread(NULL, 0, QueryThread, job, 0, NULL);
+    if (hQueryThread == NULL) {
+        delete job;
+        return;
+    }
+    CloseHandle(hQueryThread);
+    g_queryRunning = true;
+    EnableWindow(hQueryButton, FALSE);
+    SetWindowTextW(hStatusLabel, L"Searching logs...");
+}
+
+DWORD WINAPI QueryThread(LPVOID lpParam)
+{
+    QueryJob* job = (QueryJob*)lpParam;
+    job->ok = RunLogQuery(job->folder, job->options, job->results, job->stats, job->error);
+    PostMessageW(job->hWnd, WM_QUERY_DONE, (WPARAM)job, 0);
+    return 0;
+}
+
+void ShowQueryResults(HWND hWnd, const QueryJob* job)
+{
+    if (!job->ok) {
+        SetWindowTextW(hStatusLabel, (L"Search failed: " + Utf8ToWide(job->error)).c_str());
+        return;
+    }
+    wchar_t status[160];
+    swprintf_s(status, L"%zu matches, %zu/%zu files scanned in %.2fs", job->results.size(),
+        job->stats.filesScanned, job->stats.filesTotal, job->stats.seconds);
+    SetWindowTextW(hStatusLabel, status);
+
+    if (hQueryWindow == NULL) {
+        hQueryWindow = CreateWindowW(L"SerialMonitorQuery", L"Log Search", WS_OVERLAPPEDWINDOW,
+            CW_USEDEFAULT, 0, 900, 500, hWnd, nullptr, hInst, nullptr);
+        if (AllowDarkModeForWindow) AllowDarkModeForWindow(hQueryWindow, true);
+        hQueryListView = CreateWindowExW(0, WC_LISTVIEWW, L"", WS_CHILD | WS_VISIBLE | LVS_REPORT, 0, 0, 900, 500, hQueryWindow, NULL, hInst, NULL);
+        ListView_SetBkColor(hQueryListView, RGB(0, 0, 0));
+        ListView_SetTextBkColor(hQueryListView, RGB(0, 0, 0));
+        ListView_SetTextColor(hQueryListView, RGB(0, 255, 0));
+        ListView_SetExtendedListViewStyle(hQueryListView, LVS_EX_FULLROWSELECT | LVS_EX_DOUBLEBUFFER);
+        SetWindowTheme(hQueryListView, L"Explorer", NULL);
+        LVCOLUMNW lvc = { 0 };
+        lvc.mask = LVCF_TEXT | LVCF_WIDTH | LVCF_SUBITEM;
+        lvc.cx = 140;
+        lvc.pszText = (LPWSTR)L"Log Started";
+        ListView_InsertColumn(hQueryListView, 0, &lvc);
+        lvc.cx = 280;
+        lvc.pszText = (LPWSTR)L"File:Line";
+        ListView_InsertColumn(hQueryListView, 1, &lvc);
+        lvc.cx = 460;
+        lvc.pszText = (LPWSTR)L"Text";
+        ListView_InsertColumn(hQueryListView, 2, &lvc);
+    }
+    SetWindowTextW(hQueryWindow, (L"Log Search: " + Utf8ToWide(job->options.pattern)).c_str());
+    SendMessageW(hQueryListView, WM_SETREDRAW, FALSE, 0);
+    ListView_DeleteAllItems(hQueryListView);
+    TimestampFormatter formatter;
+    for (const QueryMatch& m : job->results) {
+        std::wstring when = Utf8ToWide(formatter.Format(m.timeMs).substr(0, 19));
+        std::wstring where = Utf8ToWide(m.file) + L":" + std::to_wstring(m.line);
+        std::wstring text = Utf8ToWide(m.text);
+        LVITEMW lvi = { 0 };
+        lvi.mask = LVIF_TEXT;
+        lvi.iItem = ListView_GetItemCount(hQueryListView);
+        lvi.pszText = (LPWSTR)when.c_str();
+        int index = ListView_InsertItem(hQueryListView, &lvi);
+        ListView_SetItemText(hQueryListView, index, 1, (LPWSTR)where.c_str());
+        ListView_SetItemText(hQueryListView, index, 2, (LPWSTR)text.c_str());
+    }
+    SendMessageW(hQueryListView, WM_SETREDRAW, TRUE, 0);
+    int count = ListView_GetItemCount(hQueryListView);
+    if (count > 0) ListView_EnsureVisible(hQueryListView, count - 1, FALSE);
+    ShowWindow(hQueryWindow, SW_SHOW);
+    SetForegroundWindow(hQueryWindow);
+}
+
+LRESULT CALLBACK QueryWndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    switch (message)
+    {
+    case WM_SIZE:
+        MoveWindow(hQueryListView, 0, 0, LOWORD(lParam), HIWORD(lParam), TRUE);
+        break;
+    case WM_DESTROY:
+        hQueryWindow = NULL;
+        break;
+    default: return DefWindowProc(hWnd, message, wParam, lParam);
+    }
+    return 0;
+}
+
+std::wstring DefaultLogDir()
+{
+    wchar_t buffer[MAX_PATH] = L"";
+    HKEY hKey;
+    DWORD bufferSize = sizeof(buffer);
+    if (RegOpenKeyExW(HKEY_CURRENT_USER, L"Software\\CppSerialMonitor", 0, KEY_READ, &hKey) == ERROR_SUCCESS) {
+        if (RegQueryValueExW(hKey, L"LastLogDir", NULL, NULL, (LPBYTE)buffer, &bufferSize) != ERROR_SUCCESS) buffer[0] = L'\0';
+        RegCloseKey(hKey);
+    }
+    if (buffer[0] == L'\0') SHGetFolderPathW(NULL, CSIDL_MYDOCUMENTS, NULL, 0, buffer);
+    return buffer;
+}
+
+// SerialMonitor.exe --query <pattern> [--dir <folder>] [--regex] [--ignore-case] [--max N] [--no-cache]
+int RunQueryCommand(int argc, LPWSTR* argv)
+{
+    AttachCommandConsole();
+
+    QueryOptions options;
+    std::wstring folder = DefaultLogDir();
+    for (int i = 1; i < argc; i++) {
+        std::wstring arg = argv[i];
+        if (arg == L"--query" && i + 1 < argc) options.pattern = WideToUtf8(argv[++i]);
+        else if (arg == L"--dir" && i + 1 < argc) folder = argv[++i];
+        else if (arg == L"--regex") options.regex = true;
+        else if (arg == L"--ignore-case") options.ignoreCase = true;
+        else if (arg == L"--max" && i + 1 < argc) options.maxResults = (size_t)_wtoi(argv[++i]);
+        else if (arg == L"--no-cache") options.useCache = false;
+        else {
+            printf("usage: SerialMonitor --query <pattern> [--dir <folder>] [--regex] [--ignore-case] [--max N] [--no-cache]\n");
+            return 2;
+        }
+    }
+
+    std::vector<QueryMatch> results;
+    QueryStats stats;
+    std::string error;
+    if (!RunLogQuery(WideToUtf8(folder), options, results, stats, error)) {
+        printf("error: %s\n", error.c_str());
+        return 1;
+    }
+    TimestampFormatter formatter;
+    for (const QueryMatch& m : results) {
+        printf("%s  %s:%u: %s\n", formatter.Format(m.timeMs).substr(0, 19).c_str(), m.file.c_str(), m.line, m.text.c_str());
+    }
+    printf("%zu matches, %zu/%zu files scanned (%.1f MB) in %.2fs\n", results.size(), stats.filesScanned,
+        stats.filesTotal, stats.bytesScanned / 1e6, stats.seconds);
+    fflush(stdout);
+    return results.empty() ? 1 : 0;
+}
+
+// Colour of each merged input in the merge window, cycled by input index.
+static const COLORREF g_mergeColors[] = {
+    RGB(0, 255, 0), RGB(0, 220, 255), RGB(255, 220, 0), RGB(255, 110, 255), RGB(120, 150, 255), RGB(255, 90, 90)
+};
+
+// Picks several capture files and a target, then merges them on a worker thread.
+void StartMerge(HWND hWnd)
+{
+    if (g_mergeJob) return;
+    std::vector<wchar_t> files(32 * 1024, L'\0');
+    wchar_t logDirW[MAX_PATH];
+    GetWindowTextW(hLogDirEdit, logDirW, MAX_PATH);
+    OPENFILENAMEW ofn = { 0 };
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = hWnd;
+    ofn.lpstrFile = files.data();
+    ofn.nMaxFile = (DWORD)files.size();
+    ofn.lpstrInitialDir = logDirW;
+    ofn.lpstrFilter = L"Capture files\0capture_*.txt\0All files\0*.*\0";
+    ofn.lpstrTitle = L"Select captures to merge";
+    ofn.Flags = OFN_FILEMUSTEXIST | OFN_PATHMUSTEXIST | OFN_ALLOWMULTISELECT | OFN_EXPLORER;
+    if (!GetOpenFileNameW(&ofn)) return;
+
+    // Multi-select returns "folder\0name\0name\0\0", or a single full path
+    MergeJob* job = new MergeJob();
+    job->hWnd = hWnd;
+    std::wstring folder = files.data();
+    const wchar_t* name = files.data() + folder.size() + 1;
+    if (*name == L'\0') job->request.inputs.push_back(WideToUtf8(folder));
+    for (; *name; name += wcslen(name) + 1) {
+        job->request.inputs.push_back(WideToUtf8(folder + L"\\" + name));
+    }
+
+    wchar_t path[MAX_PATH] = L"merged.txt";
+    ofn.lpstrFile = path;
+    ofn.nMaxFile = MAX_PATH;
+    ofn.lpstrFilter = L"Text files\0*.txt\0";
+    ofn.lpstrDefExt = L"txt";
+    ofn.lpstrTitle = L"Save merged capture";
+    ofn.Flags = OFN_OVERWRITEPROMPT | OFN_PATHMUSTEXIST;
+    if (!GetSaveFileNameW(&ofn)) {
+        delete job;
+        return;
+    }
+    job->request.outputPath = WideToUtf8(path);
+    job->request.keepTail = 5000;
+
+    g_hMergeThread = CreateThread(NULL, 0, MergeThread, job, 0, NULL);
+    if (g_hMergeThread == NULL) {
+        delete job;
+        return;
+    }
+    g_mergeJob = job;
+    SetWindowTextW(hStatusLabel, L"Merging captures...");
+}
+
+// Asks the running merge to stop. With wait the worker is joined and the job freed
+// here, so a merge never outlives the window; its pending WM_MERGE_DONE is ignored.
+void CancelMerge(bool wait)
+{
+    if (!g_mergeJob) return;
+    g_mergeJob->status.cancel = true;
+    if (!wait) return;
+    WaitForSingleObject(g_hMergeThread, INFINITE);
+    CloseHandle(g_hMergeThread);
+    g_hMergeThread = NULL;
+    delete g_mergeJob;
+    g_mergeJob = nullptr;
+}
+
+DWORD WINAPI MergeThread(LPVOID lpParam)
+{
+    MergeJob* job = (MergeJob*)lpParam;
+    job->ok = RunMerge(job->request, job->status);
+    PostMessageW(job->hWnd, WM_MERGE_DONE, (WPARAM)job, 0);
+    return 0;
+}
+
+// Shows the newest merged lines, each row coloured by the capture it came from.
+void ShowMergeResults(HWND hWnd, const MergeJob* job)
+{
+    if (!job->ok && job->status.cancel) {
+        wchar_t status[128];
+        swprintf_s(status, L"Merge stopped after %llu lines.", (unsigned long long)job->status.rows.load());
+        SetWindowTextW(hStatusLabel, status);
+        if (job->status.tail.empty()) return;
+    }
+    else if (!job->ok) {
+        SetWindowTextW(hStatusLabel, (L"Merge failed: " + Utf8ToWide(job->status.error)).c_str());
+        return;
+    }
+    else {
+        wchar_t status[128];
+        swprintf_s(status, L"Merged %llu lines from %zu files.", (unsigned long long)job->status.rows.load(), job->request.inputs.size());
+        SetWindowTextW(hStatusLabel, status);
+    }
+
+    if (hMergeWindow == NULL) {
+        hMergeWindow = CreateWindowW(L"SerialMonitorMerge", L"Merged Captures", WS_OVERLAPPEDWINDOW,
+            CW_USEDEFAULT, 0, 900, 500, hWnd, nullptr, hInst, nullptr);
+        if (AllowDarkModeForWindow) AllowDarkModeForWindow(hMergeWindow, true);
+        hMergeListView = CreateWindowExW(0, WC_LISTVIEWW, L"", WS_CHILD | WS_VISIBLE | LVS_REPORT, 0, 0, 900, 500, hMergeWindow, NULL, hInst, NULL);
+        ListView_SetBkColor(hMergeListView, RGB(0, 0, 0));
+        ListView_SetTextBkColor(hMergeListView, RGB(0, 0, 0));
+        ListView_SetTextColor(hMergeListView, RGB(0, 255, 0));
+        ListView_SetExtendedListViewStyle(hMergeListView, LVS_EX_FULLROWSELECT | LVS_EX_DOUBLEBUFFER);
+        SetWindowTheme(hMergeListView, L"Explorer", NULL);
+        LVCOLUMNW lvc = { 0 };
+        lvc.mask = LVCF_TEXT | LVCF_WIDTH | LVCF_SUBITEM;
+        lvc.cx = 170;
+        lvc.pszText = (LPWSTR)L"Timestamp";
+        ListView_InsertColumn(hMergeListView, 0, &lvc);
+        lvc.cx = 90;
+        lvc.pszText = (LPWSTR)L"Port";
+        ListView_InsertColumn(hMergeListView, 1, &lvc);
+        lvc.cx = 620;
+        lvc.pszText = (LPWSTR)L"Text";
+        ListView_InsertColumn(hMergeListView, 2, &lvc);
+    }
+    SetWindowTextW(hMergeWindow, (L"Merged Captures: " + Utf8ToWide(job->request.outputPath)).c_str());
+    SendMessageW(hMergeListView, WM_SETREDRAW, FALSE, 0);
+    ListView_DeleteAllItems(hMergeListView);
+    TimestampFormatter formatter;
+    char stamp[TIMESTAMP_LEN];
+    for (const MergedLine& m : job->status.tail) {
+        formatter.Format(m.timeMs, stamp);
+        std::wstring when = Utf8ToWide(std::string(stamp, TIMESTAMP_LEN));
+        std::wstring port = Utf8ToWide(job->status.labels[m.source]);
+        std::wstring text = Utf8ToWide(m.text);
+        LVITEMW lvi = { 0 };
+        lvi.mask = LVIF_TEXT | LVIF_PARAM;
+        lvi.iItem = ListView_GetItemCount(hMergeListView);
+        lvi.pszText = (LPWSTR)when.c_str();
+        lvi.lParam = (LPARAM)m.source;
+        int index = ListView_InsertItem(hMergeListView, &lvi);
+        ListView_SetItemText(hMergeListView, index, 1, (LPWSTR)port.c_str());
+        ListView_SetItemText(hMergeListView, index, 2, (LPWSTR)text.c_str());
+    }
+    SendMessageW(hMergeListView, WM_SETREDRAW, TRUE, 0);
+    int count = ListView_GetItemCount(hMergeListView);
+    if (count > 0) ListView_EnsureVisible(hMergeListView, count - 1, FALSE);
+    ShowWindow(hMergeWindow, SW_SHOW);
+    SetForegroundWindow(hMergeWindow);
+}
+
+LRESULT CALLBACK MergeWndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    switch (message)
+    {
+    case WM_SIZE:
+        MoveWindow(hMergeListView, 0, 0, LOWORD(lParam), HIWORD(lParam), TRUE);
+        break;
+    case WM_NOTIFY: {
+        LPNMLVCUSTOMDRAW cd = (LPNMLVCUSTOMDRAW)lParam;
+        if (cd->nmcd.hdr.hwndFrom != hMergeListView || cd->nmcd.hdr.code != NM_CUSTOMDRAW) break;
+        if (cd->nmcd.dwDrawStage == CDDS_PREPAINT) return CDRF_NOTIFYITEMDRAW;
+        if (cd->nmcd.dwDrawStage == CDDS_ITEMPREPAINT) {
+            cd->clrText = g_mergeColors[cd->nmcd.lItemlParam % (sizeof(g_mergeColors) / sizeof(g_mergeColors[0]))];
+            cd->clrTextBk = RGB(0, 0, 0);
+        }
+        return CDRF_DODEFAULT;
+    }
+    case WM_DESTROY:
+        hMergeWindow = NULL;
+        break;
+    default: return DefWindowProc(hWnd, message, wParam, lParam);
+    }
+    return 0;
+}
+
+// SerialMonitor.exe --merge <out.txt|-> <capture|tcp:port>... [--color]
+// "tcp:port" follows another instance's lines share live until it disconnects.
+int RunMergeCommand(int argc, LPWSTR* argv)
+{
+    AttachCommandConsole();
+
+    MergeRequest request;
+    for (int i = 2; i < argc; i++) {
+        std::wstring arg = argv[i];
+        if (i == 2) request.outputPath = WideToUtf8(arg);
+        else if (arg == L"--color") request.color = true;
+        else request.inputs.push_back(WideToUtf8(arg));
+    }
+    if (request.inputs.empty()) {
+        printf("usage: SerialMonitor --merge <out.txt|-> <capture|tcp:port>... [--color]\n");
+        return 2;
+    }
+    if (request.color) {
+        DWORD mode = 0;
+        HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
+        if (GetConsoleMode(hOut, &mode)) SetConsoleMode(hOut, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+    }
+
+    MergeStatus status;
+    if (!RunMerge(request, status)) {
+        printf("error: %s\n", status.error.c_str());
+        return 1;
+    }
+    if (request.outputPath != "-") printf("%llu lines merged into %s\n", (unsigned long long)status.rows.load(), request.outputPath.c_str());
+    fflush(stdout);
+    return 0;
+}
+
+std::wstring ProfilesDir()
+{
+    wchar_t buffer[MAX_PATH] = L"";
+    SHGetFolderPathW(NULL, CSIDL_APPDATA, NULL, 0, buffer);
+    return std::wstring(buffer) + L"\\CppSerialMonitor\\Profiles";
+}
+
+// Callers check IsValidProfileName first; the name becomes part of the path.
+std::wstring ProfilePath(const std::wstring& name)
+{
+    return ProfilesDir() + L"\\" + name + L".smprofile";
+}
+
+// Settings of the last session that had no named profile, kept outside the
+// Profiles folder so it is not listed as one.
+std::wstring SessionProfilePath()
+{
+    wchar_t buffer[MAX_PATH] = L"";
+    SHGetFolderPathW(NULL, CSIDL_APPDATA, NULL, 0, buffer);
+    return std::wstring(buffer) + L"\\CppSerialMonitor\\LastSession.smprofile";
+}
+
+// Names typed into the profile box must be checked before they become a path.
+bool CheckProfileName(HWND hWnd, const std::wstring& name)
+{
+    if (IsValidProfileName(WideToUtf8(name))) return true;
+    MessageBoxW(hWnd, L"Type a profile name first. Names may use letters, digits, spaces, '-', '_' and '.'.",
+        L"Profile", MB_OK | MB_ICONWARNING);
+    return false;
+}
+
+void RefreshProfileList()
+{
+    wchar_t current[80];
+    GetWindowTextW(hProfileCombo, current, 80);
+    SendMessageW(hProfileCombo, CB_RESETCONTENT, 0, 0);
+    WIN32_FIND_DATAW fd;
+    HANDLE hFind = FindFirstFileW((ProfilesDir() + L"\\*.smprofile").c_str(), &fd);
+    if (hFind != INVALID_HANDLE_VALUE) {
+        do {
+            std::wstring name = fd.cFileName;
+            name.erase(name.size() - 10); // ".smprofile"
+            SendMessageW(hProfileCombo, CB_ADDSTRING, 0, (LPARAM)name.c_str());
+        } while (FindNextFileW(hFind, &fd));
+        FindClose(hFind);
+    }
+    SetWindowTextW(hProfileCombo, current);
+}
+
+void ApplyProfileToControls(const SessionProfile& profile)
+{
+    if (!profile.port.empty()) SelectOrAddComboString(hPortCombo, Utf8ToWide(profile.port));
+    SelectOrAddComboString(hBaudCombo, std::to_wstring(profile.baud));
+    SetWindowTextW(hLogDirEdit, ProfileLogDir(profile).c_str());
+    SetWindowTextW(hTriggerEdit, Utf8ToWide(profile.triggers).c_str());
+    SetWindowTextW(hShareEdit, Utf8ToWide(profile.share).c_str());
+    g_foldMode = profile.foldMode;
+    SendMessageW(hFoldCombo, CB_SETCURSEL, profile.foldMode, 0);
+}
+
+// Settings that have a control come from the control; the rest stay as loaded.
+void ReadProfileFromControls(SessionProfile& profile)
+{
+    wchar_t buffer[MAX_PATH];
+    GetWindowTextW(hPortCombo, buffer, 32);
+    profile.port = WideToUtf8(buffer);
+    GetWindowTextW(hBaudCombo, buffer, 16);
+    if (_wtoi(buffer) > 0) profile.baud = (uint32_t)_wtoi(buffer);
+    GetWindowTextW(hLogDirEdit, buffer, MAX_PATH);
+    profile.logDir = WideToUtf8(buffer);
+    profile.triggers = WideToUtf8(GetControlText(hTriggerEdit));
+    profile.share = WideToUtf8(GetControlText(hShareEdit));
+    profile.foldMode = (int)g_foldMode;
+}
+
+// Loads a profile into the controls. A profile with auto_connect starts
+// monitoring once the window is up; while connected it applies on the next connect.
+bool LoadProfileByName(HWND hWnd, const std::wstring& name)
+{
+    if (!IsValidProfileName(WideToUtf8(name))) {
+        SetWindowTextW(hStatusLabel, (L"Profile not loaded: invalid name '" + name + L"'").c_str());
+        return false;
+    }
+    SessionProfile profile;
+    std::string error;
+    if (!LoadProfileFile(WideToUtf8(ProfilePath(name)), profile, error)) {
+        SetWindowTextW(hStatusLabel, (L"Profile not loaded: " + Utf8ToWide(error)).c_str());
+        return false;
+    }
+    g_profile = profile;
+    ApplyProfileToControls(profile);
+    SetWindowTextW(hProfileCombo, name.c_str());
+    SetWindowTextW(hStatusLabel, (L"Profile loaded: " + name).c_str());
+    if (profile.autoConnect && hThread == NULL && !bShouldBeMonitoring) {
+        PostMessageW(hWnd, WM_COMMAND, MAKEWPARAM(IDC_START_BUTTON, BN_CLICKED), 0);
+    }
+    return true;
+}
+
+void SaveCurrentProfile(HWND hWnd)
+{
+    wchar_t nameW[80];
+    GetWindowTextW(hProfileCombo, nameW, 80);
+    if (!CheckProfileName(hWnd, nameW)) return;
+    ReadProfileFromControls(g_profile);
+    SHCreateDirectoryExW(NULL, ProfilesDir().c_str(), NULL);
+    std::string error;
+    if (!SaveProfileFile(WideToUtf8(ProfilePath(nameW)), g_profile, error)) {
+        SetWindowTextW(hStatusLabel, (L"Profile not saved: " + Utf8ToWide(error)).c_str());
+        return;
+    }
+    RefreshProfileList();
+    SetWindowTextW(hProfileCombo, nameW);
+    SetWindowTextW(hStatusLabel, (std::wstring(L"Profile saved: ") + nameW).c_str());
+}
+
+// Line settings, decoder, highlights and log policy are edited in the file
+// itself; choosing the profile again in the list reloads it.
+void EditCurrentProfile(HWND hWnd)
+{
+    wchar_t nameW[80];
+    GetWindowTextW(hProfileCombo, nameW, 80);
+    if (!CheckProfileName(hWnd, nameW)) return;
+    std::wstring path = ProfilePath(nameW);
+    if (GetFileAttributesW(path.c_str()) == INVALID_FILE_ATTRIBUTES) {
+        SaveCurrentProfile(hWnd);
+        if (GetFileAttributesW(path.c_str()) == INVALID_FILE_ATTRIBUTES) return;
+    }
+    ShellExecuteW(hWnd, L"open", L"notepad.exe", (L"\"" + path + L"\"").c_str(), NULL, SW_SHOWNORMAL);
+}
+
+static volatile bool g_headlessStop = false;
+
+static BOOL WINAPI HeadlessCtrlHandler(DWORD)
+{
+    g_headlessStop = true;
+    return TRUE;
+}
+
+// Lines go to stdout in capture format, status and trigger events to stderr.
+class ConsoleSink : public SerialSink {
+public:
+    ConsoleSink(const SessionProfile& profile, unsigned seconds)
+        : m_profile(profile), m_stopAt(seconds ? GetTickCount64() + seconds * 1000ULL : 0) {}
+    bool KeepReading() override { return !g_headlessStop && (m_stopAt == 0 || GetTickCount64() < m_stopAt); }
+    void OnStatus(const std::wstring& text) override { fprintf(stderr, "%s\n", WideToUtf8(text).c_str()); }
+    void OnLines(uint64_t readTime, std::vector<std::string>& lines) override
+    {
+        char stamp[TIMESTAMP_LEN];
+        m_formatter.Format(readTime, stamp);
+        for (std::string& message : lines) {
+            size_t end = message.find_last_not_of("\r\n");
+            message.erase(end == std::string::npos ? 0 : end + 1);
+            fwrite(stamp, 1, TIMESTAMP_LEN, stdout);
+            fputc('\t', stdout);
+            fputs(DecodeForDisplay(m_profile, message).c_str(), stdout);
+            fputc('\n', stdout);
+        }
+        fflush(stdout);
+    }
+private:
+    const SessionProfile& m_profile;
+    ULONGLONG m_stopAt;
+    TimestampFormatter m_formatter;
+};
+
+// SerialMonitor.exe --headless [--profile <name|file.smprofile>] [--seconds N]
+// Opens the port from a profile (default: the GUI's last profile or session), logs
+// per its log policy and prints received lines to stdout in capture format.
+int RunHeadlessCommand(int argc, LPWSTR* argv)
+{
+    AttachCommandConsole();
+
+    std::wstring profileArg;
+    unsigned seconds = 0;
+    for (int i = 2; i < argc; i++) {
+        std::wstring arg = argv[i];
+        if (arg == L"--profile" && i + 1 < argc) profileArg = argv[++i];
+        else if (arg == L"--seconds" && i + 1 < argc) seconds = (unsigned)_wtoi(argv[++i]);
+        else {
+            printf("usage: SerialMonitor --headless [--profile <name|file.smprofile>] [--seconds N]\n");
+            return 2;
+        }
+    }
+    if (profileArg.empty()) {
+        HKEY hKey;
+        if (RegOpenKeyExW(HKEY_CURRENT_USER, L"Software\\CppSerialMonitor", 0, KEY_READ, &hKey) == ERROR_SUCCESS) {
+            ReadRegString(hKey, L"LastProfile", profileArg);
+            RegCloseKey(hKey);
+        }
+        std::wstring session = SessionProfilePath();
+        if (profileArg.empty() && GetFileAttributesW(session.c_str()) != INVALID_FILE_ATTRIBUTES) profileArg = session;
+    }
+    if (profileArg.empty()) {
+        fprintf(stderr, "error: no --profile given and no last session saved\n");
+        return 2;
+    }
+    bool isPath = profileArg.find_first_of(L"\\/") != std::wstring::npos ||
+        (profileArg.size() > 10 && profileArg.compare(profileArg.size() - 10, 10, L".smprofile") == 0);
+    if (!isPath && !IsValidProfileName(WideToUtf8(profileArg))) {
+        fprintf(stderr, "error: invalid profile name '%s'\n", WideToUtf8(profileArg).c_str());
+        return 2;
+    }
+    std::wstring path = isPath ? profileArg : ProfilePath(profileArg);
+
+    SessionProfile profile;
+    std::string error;
+    if (!LoadProfileFile(WideToUtf8(path), profile, error)) {
+        fprintf(stderr, "error: %s\n", error.c_str());
+        return 1;
+    }
+    if (profile.port.empty()) {
+        fprintf(stderr, "error: profile has no port\n");
+        return 1;
+    }
+    StreamServerConfig shareConfig;
+    if (!ParseShareSpec(profile.share, shareConfig, error) ||
+        (!shareConfig.Empty() && !g_streamServer.Start(shareConfig, error))) {
+        fprintf(stderr, "share disabled: %s\n", error.c_str());
+    }
+
+    std::wstring warning;
+    HANDLE hSerial = OpenSerialPort(profile, warning);
+    if (hSerial == INVALID_HANDLE_VALUE) {
+        fprintf(stderr, "error: cannot open %s\n", profile.port.c_str());
+        return 1;
+    }
+    if (!warning.empty()) fprintf(stderr, "warning: %s\n", WideToUtf8(warning).c_str());
+    fprintf(stderr, "# %s at %u baud, %.0f ms after launch\n", profile.port.c_str(), profile.baud, MillisSinceLaunch());
+
+    SetConsoleCtrlHandler(HeadlessCtrlHandler, TRUE);
+    ConsoleSink sink(profile, seconds);
+    int exitCode = 0;
+    if (!RunSerialReader(hSerial, profile, sink)) {
+        fprintf(stderr, "error: lost %s\n", profile.port.c_str());
+        exitCode = 1;
+    }
+    g_streamServer.Stop();
+    CloseHandle(hSerial);
+    return exitCode;
+}
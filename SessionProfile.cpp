@@ -0,0 +1,229 @@
+#include "SessionProfile.h"
+#include "CaptureFile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* parityNames[] = { "none", "odd", "even", "mark", "space" };
+static const char* stopBitsNames[] = { "1", "1.5", "2" };
+static const char* flowNames[] = { "none", "rtscts", "xonxoff", "dtrdsr" };
+static const char* lineEndNames[] = { "lf", "cr", "crlf" };
+static const char* decoderNames[] = { "text", "hex" };
+static const char* foldNames[] = { "off", "identical", "template" };
+
+static const struct { const char* name; uint32_t color; } namedColors[] = {
+    { "red", 0xFF4040 }, { "green", 0x00FF00 }, { "yellow", 0xFFFF00 }, { "blue", 0x4080FF },
+    { "cyan", 0x00FFFF }, { "magenta", 0xFF00FF }, { "orange", 0xFFA000 }, { "white", 0xFFFFFF }
+};
+
+static std::string Trim(const std::string& s)
+{
+    size_t b = s.find_first_not_of(" \t\r");
+    if (b == std::string::npos) return std::string();
+    return s.substr(b, s.find_last_not_of(" \t\r") - b + 1);
+}
+
+static std::string Lower(std::string s)
+{
+    for (char& c : s) if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+    return s;
+}
+
+template <size_t N>
+static bool ParseEnum(const std::string& value, const char* (&names)[N], int& out)
+{
+    std::string v = Lower(value);
+    for (size_t i = 0; i < N; i++) {
+        if (v == names[i]) { out = (int)i; return true; }
+    }
+    return false;
+}
+
+static bool ParseBool(const std::string& value, bool& out)
+{
+    std::string v = Lower(value);
+    if (v == "yes" || v == "true" || v == "on" || v == "1") { out = true; return true; }
+    if (v == "no" || v == "false" || v == "off" || v == "0") { out = false; return true; }
+    return false;
+}
+
+static bool ParseUInt(const std::string& value, uint32_t minValue, uint32_t maxValue, uint32_t& out)
+{
+    if (value.empty() || value.size() > 10 || value.find_first_not_of("0123456789") != std::string::npos) return false;
+    unsigned long long v = strtoull(value.c_str(), nullptr, 10);
+    if (v < minValue || v > maxValue) return false;
+    out = (uint32_t)v;
+    return true;
+}
+
+static bool ParseColor(const std::string& value, uint32_t& out)
+{
+    if (value.size() == 7 && value[0] == '#' && value.find_first_not_of("0123456789abcdefABCDEF", 1) == std::string::npos) {
+        out = (uint32_t)strtoul(value.c_str() + 1, nullptr, 16);
+        return true;
+    }
+    std::string v = Lower(value);
+    for (const auto& c : namedColors) {
+        if (v == c.name) { out = c.color; return true; }
+    }
+    return false;
+}
+
+bool ParseProfile(const std::string& text, SessionProfile& profile, std::string& error)
+{
+    SessionProfile p;
+    size_t pos = 0;
+    int lineNo = 0;
+    if (text.compare(0, 3, "\xEF\xBB\xBF") == 0) pos = 3;
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        if (end == std::string::npos) end = text.size();
+        std::string line = Trim(text.substr(pos, end - pos));
+        pos = end + 1;
+        lineNo++;
+        if (line.empty() || line[0] == '#') continue;
+
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            error = "line " + std::to_string(lineNo) + ": expected key = value";
+            return false;
+        }
+        std::string key = Lower(Trim(line.substr(0, eq)));
+        std::string value = Trim(line.substr(eq + 1));
+        uint32_t number = 0;
+        int index = 0;
+        bool ok = true;
+        if (key == "port") p.port = value;
+        else if (key == "baud") { ok = ParseUInt(value, 50, 20000000, number); p.baud = number; }
+        else if (key == "data_bits") { ok = ParseUInt(value, 5, 8, number); p.dataBits = (uint8_t)number; }
+        else if (key == "parity") { ok = ParseEnum(value, parityNames, index); p.parity = (ProfileParity)index; }
+        else if (key == "stop_bits") { ok = ParseEnum(value, stopBitsNames, index); p.stopBits = (ProfileStopBits)index; }
+        else if (key == "flow") { ok = ParseEnum(value, flowNames, index); p.flow = (ProfileFlow)index; }
+        else if (key == "dtr_reset") ok = ParseBool(value, p.dtrReset);
+        else if (key == "line_end") { ok = ParseEnum(value, lineEndNames, index); p.lineEnd = (ProfileLineEnd)index; }
+        else if (key == "decoder") { ok = ParseEnum(value, decoderNames, index); p.decoder = (ProfileDecoder)index; }
+        else if (key == "highlight") {
+            HighlightRule rule;
+            size_t space = value.find_first_of(" \t");
+            ok = space != std::string::npos && ParseColor(value.substr(0, space), rule.color);
+            rule.text = ok ? Trim(value.substr(space)) : std::string();
+            ok = ok && !rule.text.empty();
+            if (ok) p.highlights.push_back(rule);
+        }
+        else if (key == "fold") ok = ParseEnum(value, foldNames, p.foldMode);
+        else if (key == "log") ok = ParseBool(value, p.logEnabled);
+        else if (key == "log_dir") p.logDir = value;
+        else if (key == "log_rotate_mb") ok = ParseUInt(value, 0, 1024 * 1024, p.logRotateMb);
+        else if (key == "triggers") p.triggers = value;
+        else if (key == "share") p.share = value;
+        else if (key == "auto_connect") ok = ParseBool(value, p.autoConnect);
+        else {
+            error = "line " + std::to_string(lineNo) + ": unknown key '" + key + "'";
+            return false;
+        }
+        if (!ok) {
+            error = "line " + std::to_string(lineNo) + ": bad value for " + key + ": '" + value + "'";
+            return false;
+        }
+    }
+    profile = p;
+    return true;
+}
+
+std::string FormatProfile(const SessionProfile& p)
+{
+    char color[8];
+    std::string out = "# SerialMonitor session profile\n";
+    out += "port = " + p.port + "\n";
+    out += "baud = " + std::to_string(p.baud) + "\n";
+    out += "data_bits = " + std::to_string(p.dataBits) + "\n";
+    out += std::string("parity = ") + parityNames[p.parity] + "\n";
+    out += std::string("stop_bits = ") + stopBitsNames[p.stopBits] + "\n";
+    out += std::string("flow = ") + flowNames[p.flow] + "\n";
+    out += std::string("dtr_reset = ") + (p.dtrReset ? "yes" : "no") + "\n";
+    out += std::string("line_end = ") + lineEndNames[p.lineEnd] + "\n";
+    out += std::string("decoder = ") + decoderNames[p.decoder] + "\n";
+    for (const HighlightRule& rule : p.highlights) {
+        snprintf(color, sizeof(color), "#%06x", rule.color & 0xFFFFFF);
+        out += std::string("highlight = ") + color + " " + rule.text + "\n";
+    }
+    out += std::string("fold = ") + foldNames[p.foldMode >= 0 && p.foldMode < 3 ? p.foldMode : 0] + "\n";
+    out += std::string("log = ") + (p.logEnabled ? "yes" : "no") + "\n";
+    out += "log_dir = " + p.logDir + "\n";
+    out += "log_rotate_mb = " + std::to_string(p.logRotateMb) + "\n";
+    out += "triggers = " + p.triggers + "\n";
+    out += "share = " + p.share + "\n";
+    out += std::string("auto_connect = ") + (p.autoConnect ? "yes" : "no") + "\n";
+    return out;
+}
+
+bool LoadProfileFile(const std::string& path, SessionProfile& profile, std::string& error)
+{
+    FILE* f = OpenFileUtf8(path, "rb");
+    if (!f) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::string text;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0 && text.size() < 1024 * 1024) text.append(buf, n);
+    fclose(f);
+    return ParseProfile(text, profile, error);
+}
+
+bool SaveProfileFile(const std::string& path, const SessionProfile& profile, std::string& error)
+{
+    FILE* f = OpenFileUtf8(path, "wb");
+    if (!f) {
+        error = "cannot create " + path;
+        return false;
+    }
+    std::string text = FormatProfile(profile);
+    bool ok = fwrite(text.data(), 1, text.size(), f) == text.size();
+    if (fclose(f) != 0) ok = false;
+    if (!ok) error = "write failed: " + path;
+    return ok;
+}
+
+// Windows opens the device instead of a file for these names, whatever the extension.
+static bool IsReservedDeviceName(const std::string& name)
+{
+    std::string base = Lower(Trim(name.substr(0, name.find('.'))));
+    if (base == "con" || base == "prn" || base == "aux" || base == "nul") return true;
+    return base.size() == 4 && (base.compare(0, 3, "com") == 0 || base.compare(0, 3, "lpt") == 0) &&
+        base[3] >= '1' && base[3] <= '9';
+}
+
+bool IsValidProfileName(const std::string& name)
+{
+    if (name.empty() || name.size() > 64 || name[0] == '.' || name[0] == ' ') return false;
+    for (char c : name) {
+        bool allowed = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+            c == ' ' || c == '-' || c == '_' || c == '.';
+        if (!allowed) return false;
+    }
+    return !IsReservedDeviceName(name);
+}
+
+std::string DecodeForDisplay(const SessionProfile& profile, const std::string& line)
+{
+    if (profile.decoder != DECODER_HEX) return line;
+    static const char hex[] = "0123456789ABCDEF";
+    std::string out;
+    out.reserve(line.size() * 3);
+    for (unsigned char c : line) {
+        if (!out.empty()) out.push_back(' ');
+        out.push_back(hex[c >> 4]);
+        out.push_back(hex[c & 15]);
+    }
+    return out;
+}
+
+uint32_t HighlightColor(const SessionProfile& profile, const std::string& line, uint32_t defaultColor)
+{
+    for (const HighlightRule& rule : profile.highlights) {
+        if (line.find(rule.text) != std::string::npos) return rule.color;
+    }
+    return defaultColor;
+}
@@ -0,0 +1,79 @@
+// SessionProfile.h : named session profiles stored as plain text files
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Values match the Win32 DCB constants (NOPARITY.., ONESTOPBIT..).
+enum ProfileParity { PAR_NONE, PAR_ODD, PAR_EVEN, PAR_MARK, PAR_SPACE };
+enum ProfileStopBits { STOP_1, STOP_1_5, STOP_2 };
+enum ProfileFlow { FLOW_NONE, FLOW_RTSCTS, FLOW_XONXOFF, FLOW_DTRDSR };
+enum ProfileLineEnd { LINE_END_LF, LINE_END_CR, LINE_END_CRLF };
+enum ProfileDecoder { DECODER_TEXT, DECODER_HEX };
+
+struct HighlightRule {
+    uint32_t color = 0;   // 0xRRGGBB
+    std::string text;     // rows containing this text (UTF-8) use the colour
+};
+
+// One "key = value" per line, '#' starts a comment. Unknown keys are errors
+// so typos do not silently fall back to defaults.
+//   port = COM3
+//   baud = 115200
+//   data_bits = 8                 5-8
+//   parity = none                 none|odd|even|mark|space
+//   stop_bits = 1                 1|1.5|2
+//   flow = none                   none|rtscts|xonxoff|dtrdsr
+//   dtr_reset = yes               pulse DTR after opening (resets most boards)
+//   line_end = lf                 lf|cr|crlf, what ends a display row
+//   decoder = text                text|hex
+//   highlight = #ff4040 ERROR     repeatable; #rrggbb or red|green|yellow|blue|cyan|magenta|orange|white
+//   fold = off                    off|identical|template
+//   log = yes                     write the raw log_<port>_*.txt file
+//   log_dir = D:\bench\logs       empty = Documents
+//   log_rotate_mb = 0             start a new log file after N MB, 0 = never
+//   triggers = text:PANIC; pre:5
+//   share = tcp:7000; lines:7001
+//   auto_connect = no             open the port as soon as the profile loads
+struct SessionProfile {
+    std::string port;
+    uint32_t baud = 250000;
+    uint8_t dataBits = 8;
+    ProfileParity parity = PAR_NONE;
+    ProfileStopBits stopBits = STOP_1;
+    ProfileFlow flow = FLOW_NONE;
+    bool dtrReset = true;
+    ProfileLineEnd lineEnd = LINE_END_LF;
+    ProfileDecoder decoder = DECODER_TEXT;
+    std::vector<HighlightRule> highlights;
+    int foldMode = 0;               // FoldMode
+    bool logEnabled = true;
+    std::string logDir;
+    uint32_t logRotateMb = 0;
+    std::string triggers;
+    std::string share;
+    bool autoConnect = false;
+
+    // Byte that ends a display row.
+    char LineDelimiter() const { return lineEnd == LINE_END_CR ? '\r' : '\n'; }
+};
+
+// Parses profile text (UTF-8). On failure error names the offending line.
+bool ParseProfile(const std::string& text, SessionProfile& profile, std::string& error);
+// Writes every key, so a saved profile documents all of its settings.
+std::string FormatProfile(const SessionProfile& profile);
+
+bool LoadProfileFile(const std::string& path, SessionProfile& profile, std::string& error);
+bool SaveProfileFile(const std::string& path, const SessionProfile& profile, std::string& error);
+
+// Profile names become file names: letters, digits, space, '-', '_' and '.',
+// and not a device name such as CON or COM1 (with or without an extension).
+bool IsValidProfileName(const std::string& name);
+
+// Display text for one row: unchanged for the text decoder, "48 65 6C" for hex.
+std::string DecodeForDisplay(const SessionProfile& profile, const std::string& line);
+// Colour of the first matching highlight rule, or defaultColor.
+uint32_t HighlightColor(const SessionProfile& profile, const std::string& line, uint32_t defaultColor);
@@ -0,0 +1,72 @@
+// SocketCompat.h : the few Winsock/BSD socket differences the stream code needs
+// Include before any other header that might pull in windows.h.
+//
+
+#pragma once
+
+#ifdef _WIN32
+#ifndef FD_SETSIZE
+#define FD_SETSIZE 256
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+typedef int socklen_t;
+#define SOCKET_WOULD_BLOCK() (WSAGetLastError() == WSAEWOULDBLOCK)
+#define SEND_FLAGS 0
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int SOCKET;
+#define INVALID_SOCKET (-1)
+#define closesocket close
+#define SOCKET_WOULD_BLOCK() (errno == EWOULDBLOCK || errno == EAGAIN)
+#define SEND_FLAGS MSG_NOSIGNAL
+#endif
+
+inline bool SetNonBlocking(SOCKET s)
+{
+#ifdef _WIN32
+    u_long on = 1;
+    return ioctlsocket(s, FIONBIO, &on) == 0;
+#else
+    int flags = fcntl(s, F_GETFL, 0);
+    return flags >= 0 && fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+// select() on POSIX can only watch descriptors below FD_SETSIZE; a Winsock
+// fd_set is a list, limited by how many sockets it holds instead.
+inline bool SelectCanWatch(SOCKET s)
+{
+#ifdef _WIN32
+    (void)s;
+    return true;
+#else
+    return s < FD_SETSIZE;
+#endif
+}
+
+// WSAStartup/WSACleanup are reference counted, so every user pairs its own.
+inline bool SocketsStartup()
+{
+#ifdef _WIN32
+    WSADATA wsa;
+    return WSAStartup(MAKEWORD(2, 2), &wsa) == 0;
+#else
+    return true;
+#endif
+}
+
+inline void SocketsCleanup()
+{
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
@@ -0,0 +1,502 @@
+#include "SocketCompat.h"
+#include "StreamServer.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum ClientKind { CK_RAW, CK_LINES, CK_WS_PENDING, CK_WS_RAW, CK_WS_LINES };
+
+static const size_t MAX_COPY = 64 * 1024;   // ring bytes per refill, and per WebSocket frame
+static const size_t MAX_INBOX = 64 * 1024;
+static const size_t MAX_COMMANDS = 64 * 1024;
+
+struct StreamServer::Client {
+    SOCKET sock = INVALID_SOCKET;
+    int kind = CK_RAW;
+    BroadcastRing* ring = nullptr;
+    uint64_t cursor = 0;           // next ring byte to copy out
+    std::string inbox;             // handshake text or unparsed WebSocket frames
+    std::string outbox;            // private copy of what goes out next; the only thing send() reads
+    size_t outboxSent = 0;
+    std::string deferred;          // WebSocket control frames waiting for a frame boundary
+    bool closing = false;          // close the socket once outbox and deferred are sent
+    bool dead = false;
+};
+
+// --- SHA-1 / Base64, only needed for the WebSocket accept key ---
+
+static uint32_t Rol(uint32_t v, int n) { return (v << n) | (v >> (32 - n)); }
+
+static void Sha1(const std::string& msg, unsigned char out[20])
+{
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    std::string data = msg;
+    uint64_t bitLen = (uint64_t)msg.size() * 8;
+    data.push_back((char)0x80);
+    while (data.size() % 64 != 56) data.push_back(0);
+    for (int i = 7; i >= 0; i--) data.push_back((char)(bitLen >> (i * 8)));
+    for (size_t chunk = 0; chunk < data.size(); chunk += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            const unsigned char* p = (const unsigned char*)&data[chunk + i * 4];
+            w[i] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+        }
+        for (int i = 16; i < 80; i++) w[i] = Rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+            uint32_t t = Rol(a, 5) + f + e + k + w[i];
+            e = d; d = c; c = Rol(b, 30); b = a; a = t;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+    for (int i = 0; i < 20; i++) out[i] = (unsigned char)(h[i / 4] >> (24 - (i % 4) * 8));
+}
+
+static std::string Base64(const unsigned char* data, size_t len)
+{
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = (uint32_t)data[i] << 16;
+        if (i + 1 < len) v |= (uint32_t)data[i + 1] << 8;
+        if (i + 2 < len) v |= data[i + 2];
+        out.push_back(table[(v >> 18) & 63]);
+        out.push_back(table[(v >> 12) & 63]);
+        out.push_back(i + 1 < len ? table[(v >> 6) & 63] : '=');
+        out.push_back(i + 2 < len ? table[v & 63] : '=');
+    }
+    return out;
+}
+
+static void AppendFrameHeader(std::string& out, int opcode, uint64_t len)
+{
+    out.push_back((char)(0x80 | opcode));
+    if (len < 126) {
+        out.push_back((char)len);
+    }
+    else if (len <= 0xFFFF) {
+        out.push_back((char)126);
+        out.push_back((char)(len >> 8));
+        out.push_back((char)len);
+    }
+    else {
+        out.push_back((char)127);
+        for (int i = 7; i >= 0; i--) out.push_back((char)(len >> (i * 8)));
+    }
+}
+
+// --- Configuration ---
+
+bool ParseShareSpec(const std::string& spec, StreamServerConfig& config, std::string& error)
+{
+    config = StreamServerConfig();
+    size_t start = 0;
+    while (start <= spec.size()) {
+        size_t end = spec.find(';', start);
+        if (end == std::string::npos) end = spec.size();
+        std::string entry = spec.substr(start, end - start);
+        start = end + 1;
+        size_t first = entry.find_first_not_of(" \t");
+        if (first == std::string::npos) continue;
+        entry = entry.substr(first, entry.find_last_not_of(" \t") - first + 1);
+        if (entry == "write") { config.allowWrite = true; continue; }
+        size_t colon = entry.find(':');
+        std::string key = entry.substr(0, colon);
+        int value = colon == std::string::npos ? 0 : atoi(entry.c_str() + colon + 1);
+        if (key == "ring") {
+            config.ringBytes = (size_t)value * 1024 * 1024;
+            if (value < 1 || value > 256) { error = "ring must be 1-256 (MB)"; return false; }
+            continue;
+        }
+        if (value <= 0 || value > 65535) { error = "bad port in \"" + entry + "\""; return false; }
+        if (key == "tcp") config.rawPort = (uint16_t)value;
+        else if (key == "lines") config.linesPort = (uint16_t)value;
+        else if (key == "ws") config.wsPort = (uint16_t)value;
+        else { error = "unknown share option \"" + key + "\""; return false; }
+    }
+    return true;
+}
+
+// --- BroadcastRing ---
+
+void BroadcastRing::Reset(size_t capacity)
+{
+    m_buf.assign(capacity, 0);
+    m_writeSeq = 0;
+}
+
+void BroadcastRing::Publish(const char* data, size_t len)
+{
+    if (len > m_buf.size()) {
+        data += len - m_buf.size();
+        m_writeSeq += len - m_buf.size();
+        len = m_buf.size();
+    }
+    size_t at = (size_t)(m_writeSeq % m_buf.size());
+    size_t first = m_buf.size() - at;
+    if (first >= len) {
+        memcpy(&m_buf[at], data, len);
+    }
+    else {
+        memcpy(&m_buf[at], data, first);
+        memcpy(&m_buf[0], data + first, len - first);
+    }
+    m_writeSeq += len;
+}
+
+void BroadcastRing::CopyOut(uint64_t seq, size_t len, std::string& out) const
+{
+    size_t at = (size_t)(seq % m_buf.size());
+    size_t first = m_buf.size() - at;
+    if (first >= len) {
+        out.append(&m_buf[at], len);
+    }
+    else {
+        out.append(&m_buf[at], first);
+        out.append(&m_buf[0], len - first);
+    }
+}
+
+// --- StreamServer ---
+
+bool StreamServer::Start(const StreamServerConfig& config, std::string& error)
+{
+    Stop();
+    if (!SocketsStartup()) { error = "WSAStartup failed"; return false; }
+    m_socketsReady = true;
+    m_config = config;
+    m_rawRing.Reset(config.ringBytes);
+    m_linesRing.Reset(config.ringBytes);
+    m_commands.clear();
+    m_skippedBytes = 0;
+
+    const uint16_t ports[] = { config.rawPort, config.linesPort, config.wsPort };
+    const int kinds[] = { CK_RAW, CK_LINES, CK_WS_PENDING };
+    for (int i = 0; i < 3; i++) {
+        if (ports[i] == 0) continue;
+        SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        int yes = 1;
+        setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&yes, sizeof(yes));
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(ports[i]);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (s == INVALID_SOCKET || bind(s, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(s, 16) != 0 || !SetNonBlocking(s)) {
+            if (s != INVALID_SOCKET) closesocket(s);
+            error = "cannot listen on port " + std::to_string(ports[i]);
+            Stop();
+            return false;
+        }
+        m_listeners.push_back((uintptr_t)s);
+        m_listenerKinds.push_back(kinds[i]);
+    }
+    m_running = true;
+    m_thread = std::thread(&StreamServer::Run, this);
+    return true;
+}
+
+void StreamServer::Stop()
+{
+    m_running = false;
+    if (m_thread.joinable()) m_thread.join();
+    for (Client* c : m_clients) {
+        closesocket(c->sock);
+        delete c;
+    }
+    m_clients.clear();
+    m_clientCount = 0;
+    for (uintptr_t s : m_listeners) closesocket((SOCKET)s);
+    m_listeners.clear();
+    m_listenerKinds.clear();
+    if (m_socketsReady) SocketsCleanup();
+    m_socketsReady = false;
+}
+
+void StreamServer::PublishRaw(const char* data, size_t len)
+{
+    if (!m_running || (m_config.rawPort == 0 && m_config.wsPort == 0)) return;
+    std::lock_guard<std::mutex> lock(m_ringLock);
+    m_rawRing.Publish(data, len);
+}
+
+void StreamServer::PublishLine(uint64_t timeMs, const char* text, size_t len)
+{
+    if (!m_running || (m_config.linesPort == 0 && m_config.wsPort == 0)) return;
+    while (len > 0 && (text[len - 1] == '\r' || text[len - 1] == '\n')) len--;
+    m_lineScratch.resize(TIMESTAMP_LEN + 1);
+    m_formatter.Format(timeMs, &m_lineScratch[0]);
+    m_lineScratch[TIMESTAMP_LEN] = '\t';
+    m_lineScratch.append(text, len);
+    m_lineScratch.push_back('\n');
+    std::lock_guard<std::mutex> lock(m_ringLock);
+    m_linesRing.Publish(m_lineScratch.data(), m_lineScratch.size());
+}
+
+bool StreamServer::TakeCommands(std::string& out)
+{
+    std::lock_guard<std::mutex> lock(m_commandLock);
+    if (m_commands.empty()) return false;
+    out.swap(m_commands);
+    m_commands.clear();
+    return true;
+}
+
+void StreamServer::Accept(uintptr_t listener, int kind)
+{
+    for (;;) {
+        SOCKET s = accept((SOCKET)listener, NULL, NULL);
+        if (s == INVALID_SOCKET) return;
+        if (m_clients.size() >= FD_SETSIZE - m_listeners.size() - 1 || !SelectCanWatch(s) || !SetNonBlocking(s)) {
+            closesocket(s);
+            continue;
+        }
+        int yes = 1;
+        setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&yes, sizeof(yes));
+        Client* c = new Client();
+        c->sock = s;
+        c->kind = kind;
+        c->ring = kind == CK_RAW ? &m_rawRing : &m_linesRing;
+        c->outbox.reserve(MAX_COPY + 64);
+        {
+            std::lock_guard<std::mutex> lock(m_ringLock);
+            c->cursor = c->ring->WriteSeq();
+        }
+        m_clients.push_back(c);
+        m_clientCount = m_clients.size();
+    }
+}
+
+void StreamServer::Receive(Client& client)
+{
+    char buf[4096];
+    int n = recv(client.sock, buf, sizeof(buf), 0);
+    if (n == 0 || (n < 0 && !SOCKET_WOULD_BLOCK())) { client.dead = true; return; }
+    if (n < 0 || client.closing) return;
+    if (client.kind == CK_RAW || client.kind == CK_LINES) {
+        if (!m_config.allowWrite) return;
+        std::lock_guard<std::mutex> lock(m_commandLock);
+        if (m_commands.size() + n <= MAX_COMMANDS) m_commands.append(buf, n);
+        return;
+    }
+    client.inbox.append(buf, n);
+    if (client.inbox.size() > MAX_INBOX) { client.dead = true; return; }
+    if (client.kind == CK_WS_PENDING) HandleHandshake(client);
+    else HandleFrames(client);
+}
+
+void StreamServer::HandleHandshake(Client& client)
+{
+    size_t end = client.inbox.find("\r\n\r\n");
+    if (end == std::string::npos) return;
+    std::string request = client.inbox.substr(0, end + 2);
+    client.inbox.erase(0, end + 4);
+
+    std::string key;
+    size_t pos = 0;
+    while ((pos = request.find("\r\n", pos)) != std::string::npos) {
+        pos += 2;
+        size_t colon = request.find(':', pos);
+        size_t eol = request.find("\r\n", pos);
+        if (colon == std::string::npos || colon > eol) continue;
+        std::string name = request.substr(pos, colon - pos);
+        for (char& ch : name) ch = (char)tolower((unsigned char)ch);
+        if (name == "sec-websocket-key") {
+            key = request.substr(colon + 1, eol - colon - 1);
+            key.erase(0, key.find_first_not_of(' '));
+            key.erase(key.find_last_not_of(' ') + 1);
+        }
+    }
+    if (request.compare(0, 4, "GET ") != 0 || key.empty()) {
+        client.outbox = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        client.closing = true;
+        return;
+    }
+    unsigned char digest[20];
+    Sha1(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11", digest);
+    client.outbox = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+        "Sec-WebSocket-Accept: " + Base64(digest, 20) + "\r\n\r\n";
+
+    bool raw = request.compare(4, 5, "/raw ") == 0;
+    client.kind = raw ? CK_WS_RAW : CK_WS_LINES;
+    client.ring = raw ? &m_rawRing : &m_linesRing;
+    std::lock_guard<std::mutex> lock(m_ringLock);
+    client.cursor = client.ring->WriteSeq();
+}
+
+void StreamServer::HandleFrames(Client& client)
+{
+    std::string& in = client.inbox;
+    for (;;) {
+        if (in.size() < 2) return;
+        const unsigned char* p = (const unsigned char*)in.data();
+        int opcode = p[0] & 0x0F;
+        bool masked = (p[1] & 0x80) != 0;
+        uint64_t len = p[1] & 0x7F;
+        size_t header = 2;
+        if (len == 126) {
+            if (in.size() < 4) return;
+            len = ((uint64_t)p[2] << 8) | p[3];
+            header = 4;
+        }
+        else if (len == 127) {
+            if (in.size() < 10) return;
+            len = 0;
+            for (int i = 0; i < 8; i++) len = (len << 8) | p[2 + i];
+            header = 10;
+        }
+        if (len > MAX_INBOX) { client.dead = true; return; }
+        size_t maskAt = header;
+        if (masked) header += 4;
+        if (in.size() < header + len) return;
+        std::string payload = in.substr(header, (size_t)len);
+        if (masked) {
+            for (size_t i = 0; i < payload.size(); i++) payload[i] ^= in[maskAt + (i % 4)];
+        }
+        in.erase(0, header + (size_t)len);
+
+        if (opcode == 0x8) {
+            // Answer the close handshake; Flush drops the socket once it is sent
+            AppendFrameHeader(client.deferred, 0x8, 0);
+            client.closing = true;
+            return;
+        }
+        if (opcode == 0x9) {
+            AppendFrameHeader(client.deferred, 0xA, payload.size());
+            client.deferred += payload;
+        }
+        else if ((opcode == 0x0 || opcode == 0x1 || opcode == 0x2) && m_config.allowWrite) {
+            std::lock_guard<std::mutex> lock(m_commandLock);
+            if (m_commands.size() + payload.size() <= MAX_COMMANDS) m_commands += payload;
+        }
+    }
+}
+
+// Moves a lagging client to the middle of the ring (on a line boundary for
+// line streams) and tells line clients how much they missed.
+void StreamServer::SkipAhead(Client& client)
+{
+    BroadcastRing& ring = *client.ring;
+    uint64_t target = ring.WriteSeq() - ring.Capacity() / 2;
+    if (client.ring == &m_linesRing) {
+        while (target < ring.WriteSeq() && ring.At(target) != '\n') target++;
+        if (target < ring.WriteSeq()) target++;
+    }
+    uint64_t skipped = target - client.cursor;
+    m_skippedBytes += skipped;
+    client.cursor = target;
+    if (client.kind == CK_LINES || client.kind == CK_WS_LINES) {
+        std::string notice = "[stream] skipped " + std::to_string(skipped) + " bytes\n";
+        if (client.kind == CK_WS_LINES) AppendFrameHeader(client.outbox, 0x1, notice.size());
+        client.outbox += notice;
+    }
+}
+
+// Copies the client's next span out of the ring into its outbox. This is the
+// only place ring bytes are read and it holds the ring lock, so send() works on
+// a private copy that PublishRaw can never overwrite. Returns false when there
+// is nothing to send.
+bool StreamServer::Refill(Client& client)
+{
+    bool ws = client.kind == CK_WS_RAW || client.kind == CK_WS_LINES;
+    BroadcastRing& ring = *client.ring;
+    size_t at, len;
+    bool more;
+    {
+        std::lock_guard<std::mutex> lock(m_ringLock);
+        if (ring.Overrun(client.cursor)) SkipAhead(client);
+        uint64_t available = ring.WriteSeq() - client.cursor;
+        len = available < MAX_COPY ? (size_t)available : MAX_COPY;
+        more = len < available;
+        at = client.outbox.size();
+        ring.CopyOut(client.cursor, len, client.outbox);
+        client.cursor += len;
+    }
+    if (len == 0 || !ws) return !client.outbox.empty();
+    if (client.kind == CK_WS_LINES && more) {
+        // Keep text frames on line boundaries unless a single line is enormous;
+        // the cut-off tail is copied again with the next frame
+        size_t nl = client.outbox.find_last_of('\n');
+        if (nl != std::string::npos && nl >= at) {
+            size_t keep = nl + 1 - at;
+            client.cursor -= len - keep;
+            client.outbox.resize(at + keep);
+            len = keep;
+        }
+    }
+    std::string header;
+    AppendFrameHeader(header, client.kind == CK_WS_RAW ? 0x2 : 0x1, len);
+    client.outbox.insert(at, header);
+    return true;
+}
+
+// Sends pending bytes to one client. Ring data only reaches send() through the
+// client's outbox, so a slow socket never holds the ring lock.
+void StreamServer::Flush(Client& client)
+{
+    for (;;) {
+        if (client.outboxSent < client.outbox.size()) {
+            int n = send(client.sock, client.outbox.data() + client.outboxSent,
+                (int)(client.outbox.size() - client.outboxSent), SEND_FLAGS);
+            if (n < 0) { if (!SOCKET_WOULD_BLOCK()) client.dead = true; return; }
+            client.outboxSent += n;
+            if (client.outboxSent < client.outbox.size()) return;
+        }
+        client.outbox.clear();
+        client.outboxSent = 0;
+        // WebSocket control frames go out between data frames
+        if (!client.deferred.empty()) {
+            client.outbox += client.deferred;
+            client.deferred.clear();
+            continue;
+        }
+        if (client.closing) { client.dead = true; return; }
+        if (client.kind == CK_WS_PENDING || !Refill(client)) return;
+    }
+}
+
+void StreamServer::Run()
+{
+    while (m_running) {
+        fd_set readSet, writeSet;
+        FD_ZERO(&readSet);
+        FD_ZERO(&writeSet);
+        SOCKET maxSock = 0;
+        for (uintptr_t l : m_listeners) {
+            FD_SET((SOCKET)l, &readSet);
+            if ((SOCKET)l > maxSock) maxSock = (SOCKET)l;
+        }
+        for (Client* c : m_clients) {
+            FD_SET(c->sock, &readSet);
+            if (c->outboxSent < c->outbox.size() || !c->deferred.empty()) FD_SET(c->sock, &writeSet);
+            if (c->sock > maxSock) maxSock = c->sock;
+        }
+        // Short timeout doubles as the publish poll interval
+        timeval tv = { 0, 5000 };
+        int ready = select((int)maxSock + 1, &readSet, &writeSet, NULL, &tv);
+        if (ready < 0) continue;
+
+        for (size_t i = 0; i < m_listeners.size(); i++) {
+            if (FD_ISSET((SOCKET)m_listeners[i], &readSet)) Accept(m_listeners[i], m_listenerKinds[i]);
+        }
+        for (Client* c : m_clients) {
+            if (FD_ISSET(c->sock, &readSet)) Receive(*c);
+            if (!c->dead) Flush(*c);
+        }
+        for (size_t i = 0; i < m_clients.size();) {
+            if (m_clients[i]->dead) {
+                closesocket(m_clients[i]->sock);
+                delete m_clients[i];
+                m_clients.erase(m_clients.begin() + i);
+            }
+            else {
+                i++;
+            }
+        }
+        m_clientCount = m_clients.size();
+    }
+}
@@ -0,0 +1,88 @@
+// StreamServer.h : fans the live capture stream out to local TCP and WebSocket clients
+//
+
+#pragma once
+
+#include "CaptureFile.h"
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Parsed form of the "Share" setting, e.g.
+//   tcp:7000; lines:7001; ws:7002; write
+// tcp streams raw bytes, lines streams capture-file records, ws serves
+// /raw (binary frames) and anything else as line records (text frames).
+struct StreamServerConfig {
+    uint16_t rawPort = 0;
+    uint16_t linesPort = 0;
+    uint16_t wsPort = 0;
+    bool allowWrite = false;          // forward client input to the serial port
+    size_t ringBytes = 4 * 1024 * 1024;
+    bool Empty() const { return rawPort == 0 && linesPort == 0 && wsPort == 0; }
+};
+
+bool ParseShareSpec(const std::string& spec, StreamServerConfig& config, std::string& error);
+
+// Single-writer broadcast ring addressed by a monotonically increasing byte
+// sequence. Readers keep their own cursor and copy their next span out under
+// the writer's lock; a reader more than a ring behind has lost data and must
+// skip ahead.
+class BroadcastRing {
+public:
+    void Reset(size_t capacity);
+    void Publish(const char* data, size_t len);
+    uint64_t WriteSeq() const { return m_writeSeq; }
+    size_t Capacity() const { return m_buf.size(); }
+    bool Overrun(uint64_t seq) const { return m_writeSeq - seq > m_buf.size(); }
+    // Appends len bytes starting at seq to out, across the wrap point.
+    void CopyOut(uint64_t seq, size_t len, std::string& out) const;
+    char At(uint64_t seq) const { return m_buf[(size_t)(seq % m_buf.size())]; }
+private:
+    std::vector<char> m_buf;
+    uint64_t m_writeSeq = 0;
+};
+
+class StreamServer {
+public:
+    ~StreamServer() { Stop(); }
+    bool Start(const StreamServerConfig& config, std::string& error);
+    void Stop();
+    bool Running() const { return m_running; }
+    // Capture thread only.
+    void PublishRaw(const char* data, size_t len);
+    void PublishLine(uint64_t timeMs, const char* text, size_t len);
+    // Pops bytes written by clients when write-through is enabled.
+    bool TakeCommands(std::string& out);
+    size_t ClientCount() const { return m_clientCount; }
+    uint64_t SkippedBytes() const { return m_skippedBytes; }
+private:
+    struct Client;
+    void Run();
+    void Accept(uintptr_t listener, int kind);
+    void Receive(Client& client);
+    void HandleHandshake(Client& client);
+    void HandleFrames(Client& client);
+    void Flush(Client& client);
+    bool Refill(Client& client);
+    void SkipAhead(Client& client);
+
+    StreamServerConfig m_config;
+    std::vector<uintptr_t> m_listeners;
+    std::vector<int> m_listenerKinds;
+    std::vector<Client*> m_clients;
+    std::thread m_thread;
+    std::atomic<bool> m_running{ false };
+    bool m_socketsReady = false;
+    std::atomic<size_t> m_clientCount{ 0 };
+    std::atomic<uint64_t> m_skippedBytes{ 0 };
+
+    std::mutex m_ringLock;             // writer copy-in vs. server copy-out
+    BroadcastRing m_rawRing, m_linesRing;
+    std::mutex m_commandLock;
+    std::string m_commands;
+    TimestampFormatter m_formatter;
+    std::string m_lineScratch;
+};
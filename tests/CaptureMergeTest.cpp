@@ -0,0 +1,151 @@
+// CaptureMergeTest.cpp : ordering, ties, labels, untimestamped inputs and a live input
+//
+
+#include "CaptureMerge.h"
+#include "StreamServer.h"
+#include "TestCheck.h"
+#include <chrono>
+#include <string.h>
+#include <thread>
+
+static void WriteCapture(const char* path, uint64_t start, const std::vector<uint64_t>& offsets, const char* tag)
+{
+    CaptureWriter writer;
+    CHECK(writer.Open(path));
+    for (size_t i = 0; i < offsets.size(); i++) {
+        std::string text = std::string(tag) + " " + std::to_string(i);
+        writer.WriteLine(start + offsets[i], text.data(), text.size());
+    }
+}
+
+static std::vector<CaptureLine> ReadCapture(const char* path)
+{
+    std::vector<CaptureLine> lines;
+    CaptureReader reader;
+    if (!reader.Open(path)) return lines;
+    CaptureLine line;
+    while (reader.Next(line)) lines.push_back(line);
+    return lines;
+}
+
+static void TestFileMerge()
+{
+    const uint64_t base = 1700000000000ULL;
+    WriteCapture("capture_COM1_a.txt", base, { 0, 10, 20, 30, 40 }, "one");
+    WriteCapture("capture_COM2_b.txt", base, { 5, 10, 25, 26, 27, 90 }, "two");
+    WriteCapture("capture_COM3_c.txt", base, { 10 }, "three");
+    WriteCapture("capture_COM4_d.txt", base, {}, "empty");
+
+    MergeRequest request;
+    request.inputs = { "capture_COM1_a.txt", "capture_COM2_b.txt", "capture_COM3_c.txt", "capture_COM4_d.txt" };
+    request.outputPath = "merged_files.txt";
+    request.keepTail = 3;
+    MergeStatus status;
+    CHECK(RunMerge(request, status));
+    CHECK(status.rows == 12);
+    CHECK(status.permille == 1000);
+    CHECK(status.labels.size() == 4 && status.labels[0] == "COM1" && status.labels[3] == "COM4");
+    CHECK(status.tail.size() == 3 && status.tail.back().text == "two 5");
+
+    std::vector<CaptureLine> merged = ReadCapture("merged_files.txt");
+    CHECK(merged.size() == 12);
+    bool sorted = true;
+    for (size_t i = 1; i < merged.size(); i++) sorted = sorted && merged[i - 1].timeMs <= merged[i].timeMs;
+    CHECK(sorted);
+    // Three lines at +10 ms keep input order
+    if (merged.size() == 12) {
+        CHECK(merged[0].text == "[COM1] one 0");
+        CHECK(merged[1].text == "[COM2] two 0");
+        CHECK(merged[2].text == "[COM1] one 1");
+        CHECK(merged[3].text == "[COM2] two 1");
+        CHECK(merged[4].text == "[COM3] three 0");
+        CHECK(merged[2].timeMs == base + 10 && merged[4].timeMs == base + 10);
+    }
+
+    // The merged file is itself a capture and merges again
+    MergeRequest again;
+    again.inputs = { "merged_files.txt", "capture_COM3_c.txt" };
+    again.outputPath = "merged_again.txt";
+    MergeStatus againStatus;
+    CHECK(RunMerge(again, againStatus));
+    CHECK(againStatus.rows == 13);
+
+    for (const char* path : { "capture_COM1_a.txt", "capture_COM2_b.txt", "capture_COM3_c.txt", "capture_COM4_d.txt",
+        "merged_files.txt", "merged_again.txt" }) {
+        remove(path);
+    }
+}
+
+static void TestUntimestampedRejected()
+{
+    FILE* f = fopen("log_COM5_2023-11-14_22-13-20.txt", "wb");
+    CHECK(f != nullptr);
+    if (f) {
+        fputs("boot\r\nready\r\n", f);
+        fclose(f);
+    }
+    WriteCapture("capture_COM6_x.txt", 1700000000000ULL, { 0, 1 }, "cap");
+
+    MergeRequest request;
+    request.inputs = { "capture_COM6_x.txt", "log_COM5_2023-11-14_22-13-20.txt" };
+    request.outputPath = "merged_raw.txt";
+    MergeStatus status;
+    CHECK(!RunMerge(request, status));
+    CHECK(status.error.find("log_COM5_2023-11-14_22-13-20.txt") != std::string::npos);
+    CHECK(status.error.find("no timestamps") != std::string::npos);
+
+    request.inputs = { "capture_COM6_x.txt", "does_not_exist.txt" };
+    CHECK(!RunMerge(request, status));
+    CHECK(status.error == "cannot open does_not_exist.txt");
+
+    remove("log_COM5_2023-11-14_22-13-20.txt");
+    remove("capture_COM6_x.txt");
+    remove("merged_raw.txt");
+}
+
+// A lines share from another monitor interleaves with a file as it arrives
+static void TestLiveInput()
+{
+    StreamServer server;
+    StreamServerConfig config;
+    config.linesPort = 27460;
+    std::string error;
+    CHECK(server.Start(config, error));
+    uint64_t now = NowMillis();
+    WriteCapture("capture_COM8_live.txt", now, { 0, 150, 300 }, "file");
+
+    MergeRequest request;
+    request.inputs = { "tcp:27460", "capture_COM8_live.txt" };
+    request.outputPath = "merged_live.txt";
+    MergeStatus status;
+    std::thread merge([&] { RunMerge(request, status); });
+    for (int i = 0; i < 100 && server.ClientCount() == 0; i++) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    for (int i = 0; i < 4; i++) {
+        server.PublishLine(now + 75 + i * 150, "live", 4);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    server.Stop();
+    merge.join();
+    CHECK(status.error.empty());
+
+    std::vector<CaptureLine> merged = ReadCapture("merged_live.txt");
+    CHECK(merged.size() == 7);
+    bool sorted = true;
+    for (size_t i = 1; i < merged.size(); i++) sorted = sorted && merged[i - 1].timeMs <= merged[i].timeMs;
+    CHECK(sorted);
+    if (merged.size() == 7) {
+        CHECK(merged[0].text == "[COM8] file 0");
+        CHECK(merged[1].text == "[tcp:27460] live");
+    }
+    remove("capture_COM8_live.txt");
+    remove("merged_live.txt");
+}
+
+int main()
+{
+    TestFileMerge();
+    TestUntimestampedRejected();
+    TestLiveInput();
+    return CheckResult();
+}
@@ -0,0 +1,304 @@
+// CaptureTriggerTest.cpp : ring, matcher and a replayed stream with embedded faults
+//
+
+#include "CaptureTrigger.h"
+#include "TestCheck.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void TestRingWrap()
+{
+    RawRing ring;
+    ring.Reset(1000);
+    uint64_t lastPushed = 0;
+    for (uint64_t t = 1; t <= 5000; t++) {
+        std::string chunk((size_t)(t * 7 % 90), (char)('a' + t % 26));
+        ring.Push(t, chunk.data(), chunk.size());
+        lastPushed = t;
+        CHECK(ring.Used() <= 1000);
+    }
+    // Oldest first, contiguous up to the newest chunk, contents intact across the wrap
+    uint64_t prev = 0, count = 0;
+    bool intact = true, ordered = true;
+    ring.ForEachSince(0, [&](uint64_t t, const char* data, size_t len) {
+        if (prev && t != prev + 1) ordered = false;
+        if (len != (size_t)(t * 7 % 90)) intact = false;
+        for (size_t i = 0; i < len; i++) if (data[i] != (char)('a' + t % 26)) intact = false;
+        prev = t;
+        count++;
+    });
+    CHECK(ordered);
+    CHECK(intact);
+    CHECK(prev == lastPushed);
+    CHECK(count > 10);
+
+    uint64_t first = 0;
+    ring.ForEachSince(lastPushed - 3, [&](uint64_t t, const char*, size_t) { if (!first) first = t; });
+    CHECK(first == lastPushed - 3);
+
+    // A chunk larger than the ring keeps its newest bytes
+    std::string big(5000, 'x');
+    big.replace(big.size() - 3, 3, "end");
+    ring.Push(9999, big.data(), big.size());
+    std::string kept;
+    ring.ForEachSince(0, [&](uint64_t, const char* data, size_t len) { kept.assign(data, len); });
+    CHECK(ring.Used() <= 1000);
+    CHECK(kept.size() > 900 && kept.compare(kept.size() - 3, 3, "end") == 0);
+}
+
+// Index of the earliest pattern end inside [from, stream.size()), or npos.
+static size_t NaiveFirstEnd(const std::string& stream, size_t from, const std::vector<std::string>& patterns)
+{
+    for (size_t end = from + 1; end <= stream.size(); end++) {
+        for (const std::string& p : patterns) {
+            if (end >= p.size() && stream.compare(end - p.size(), p.size(), p) == 0) return end;
+        }
+    }
+    return std::string::npos;
+}
+
+static void TestMatcherOverlaps()
+{
+    PatternMatcher m;
+    m.Build({ "abab" });
+    CHECK(m.Feed((const unsigned char*)"aba", 3) == -1);
+    CHECK(m.Feed((const unsigned char*)"b", 1) == 0);
+    CHECK(m.Feed((const unsigned char*)"ab", 2) == 0);   // overlaps the previous match
+
+    m.Build({ "aab" });
+    CHECK(m.Feed((const unsigned char*)"aaaa", 4) == -1);
+    CHECK(m.Feed((const unsigned char*)"b", 1) == 0);     // needs the failure link
+
+    m.Build({ "she", "he", "hers" });
+    CHECK(m.Feed((const unsigned char*)"ush", 3) == -1);
+    CHECK(m.Feed((const unsigned char*)"e", 1) >= 0);
+    CHECK(m.Feed((const unsigned char*)"rs", 2) == 2);
+
+    m.Build({ std::string("\xDE\xAD\x00\xFF", 4) });
+    CHECK(m.Feed((const unsigned char*)"\xDE\xAD", 2) == -1);
+    CHECK(m.Feed((const unsigned char*)"\x00\xFF", 2) == 0);
+
+    // Random two-letter streams in random chunks against a naive search
+    std::vector<std::string> patterns = { "abba", "bab", "aaaa", "abaab" };
+    m.Build(patterns);
+    srand(26);
+    std::string stream;
+    bool agree = true;
+    for (int chunk = 0; chunk < 20000 && agree; chunk++) {
+        size_t from = stream.size();
+        size_t len = 1 + rand() % 6;
+        for (size_t i = 0; i < len; i++) stream.push_back(rand() % 3 ? 'a' : 'b');
+        int hit = m.Feed((const unsigned char*)stream.data() + from, len);
+        size_t end = NaiveFirstEnd(stream, from, patterns);
+        if (end == std::string::npos) agree = hit == -1;
+        else agree = hit >= 0 && end >= patterns[hit].size() &&
+            stream.compare(end - patterns[hit].size(), patterns[hit].size(), patterns[hit]) == 0;
+    }
+    CHECK(agree);
+}
+
+struct ReplayResult {
+    std::vector<std::string> events;
+    std::vector<std::string> files;
+};
+
+static void Drain(TriggerCapture& capture, ReplayResult& result)
+{
+    std::string event;
+    while (capture.TakeEvent(event)) {
+        result.events.push_back(event);
+        if (event.compare(0, 15, "Capture saved: ") == 0) result.files.push_back(event.substr(15));
+    }
+}
+
+// Replays what the reader thread does: data in odd-sized chunks every 10 ms,
+// OnIdle on every 50 ms read timeout while the device is quiet.
+static void TestReplay()
+{
+    TriggerConfig config;
+    std::string error;
+    CHECK(ParseTriggerSpec("text:PANIC; silence:500ms; pre:1; post:2; ring:64K", config, error));
+    TriggerCapture capture;
+    capture.Configure(config, "replay_capture");
+    ReplayResult result;
+
+    const uint64_t start = 1700000000000ULL;
+    uint64_t now = start;
+    std::string pending;
+    for (int i = 0; i < 400; i++) pending += "tick " + std::to_string(i) + (i == 200 ? " PANIC here\n" : "\n");
+    uint64_t panicTime = 0;
+    size_t sent = 0;
+    while (sent < pending.size()) {
+        size_t len = pending.size() - sent < 7 ? pending.size() - sent : 7;
+        // The fault string is split across two chunks on purpose
+        size_t panic = pending.find("PANIC");
+        if (sent < panic + 2 && sent + len > panic + 2) len = panic + 2 - sent;
+        capture.OnData(now, pending.data() + sent, len);
+        if (!panicTime && sent + len > panic + 4) panicTime = now;
+        sent += len;
+        now += 10;
+        Drain(capture, result);
+    }
+    // Quiet device: only read timeouts from here on
+    for (int i = 0; i < 60; i++) {
+        now += 50;
+        capture.OnIdle(now);
+        Drain(capture, result);
+    }
+    // The post window of the silence capture closed on read timeouts alone,
+    // before Close() had a chance to save it
+    bool silenceFired = false, silenceSaved = false;
+    for (const std::string& event : result.events) {
+        if (event == "Trigger silence: capturing") silenceFired = true;
+        if (silenceFired && event.compare(0, 15, "Capture saved: ") == 0) silenceSaved = true;
+    }
+    CHECK(silenceFired);
+    CHECK(silenceSaved);
+    capture.Close();
+    Drain(capture, result);
+
+    CHECK(result.files.size() == 2);   // the PANIC window, then the silence window
+    if (result.files.size() != 2) return;
+
+    CaptureReader reader;
+    CHECK(reader.Open(result.files[0]));
+    CaptureLine line;
+    uint64_t firstMs = 0, lastMs = 0;
+    size_t lines = 0;
+    bool sawPanic = false;
+    while (reader.Next(line)) {
+        if (!lines) firstMs = line.timeMs;
+        lastMs = line.timeMs;
+        lines++;
+        if (line.text.find("PANIC") != std::string::npos) sawPanic = true;
+    }
+    reader.Close();
+    CHECK(sawPanic);
+    CHECK(firstMs >= panicTime - config.preMs && firstMs < panicTime - config.preMs + 100);
+    CHECK(lastMs < panicTime + config.postMs && lastMs + 100 > panicTime + config.postMs);
+    CHECK(lines > 100);
+    for (const std::string& path : result.files) remove(path.c_str());
+}
+
+static size_t CountEvents(const ReplayResult& result, const std::string& prefix)
+{
+    size_t n = 0;
+    for (const std::string& event : result.events) {
+        if (event.compare(0, prefix.size(), prefix) == 0) n++;
+    }
+    return n;
+}
+
+// Feeds bytesPer10ms every 10 ms for durationMs, as a steady device would.
+static void Feed(TriggerCapture& capture, ReplayResult& result, uint64_t& now, size_t bytesPer10ms, uint64_t durationMs)
+{
+    std::string chunk(bytesPer10ms, 'r');
+    for (uint64_t end = now + durationMs; now < end; now += 10) {
+        capture.OnData(now, chunk.data(), chunk.size());
+        Drain(capture, result);
+    }
+}
+
+// Fires once the last second carries more than the threshold, then stays quiet
+// until the rate has dropped below half of it.
+static void TestRate()
+{
+    TriggerConfig config;
+    std::string error;
+    CHECK(ParseTriggerSpec("rate:1000; pre:0; post:1", config, error));
+    TriggerCapture capture;
+    capture.Configure(config, "rate_capture");
+    ReplayResult result;
+    uint64_t now = 1700000000000ULL;
+
+    Feed(capture, result, now, 10, 3000);     // exactly 1000 B/s
+    CHECK(CountEvents(result, "Trigger rate") == 0);
+    Feed(capture, result, now, 20, 2000);     // 2000 B/s
+    CHECK(CountEvents(result, "Trigger rate") == 1);
+    Feed(capture, result, now, 6, 2000);      // 600 B/s: above half, stays disarmed
+    Feed(capture, result, now, 20, 2000);
+    CHECK(CountEvents(result, "Trigger rate") == 1);
+    Feed(capture, result, now, 4, 2000);      // 400 B/s re-arms
+    CHECK(CountEvents(result, "Trigger rate") == 1);
+    Feed(capture, result, now, 20, 2000);
+    CHECK(CountEvents(result, "Trigger rate") == 2);
+    capture.Close();
+    Drain(capture, result);
+    CHECK(result.files.size() == 2);
+    for (const std::string& path : result.files) remove(path.c_str());
+}
+
+static void TestBytes()
+{
+    TriggerConfig config;
+    std::string error;
+    CHECK(ParseTriggerSpec("bytes:DE AD be ef; pre:0; post:1", config, error));
+    CHECK(config.patterns.size() == 1 && config.patterns[0] == "\xDE\xAD\xBE\xEF");
+    CHECK(config.names.size() == 1 && config.names[0] == "bytes DE AD be ef");
+    TriggerCapture capture;
+    capture.Configure(config, "bytes_capture");
+    ReplayResult result;
+    uint64_t now = 1700000000000ULL;
+
+    const char noise[] = { '\0', '\xDE', '\xAD', '\xBE', '\0', '\xEF', '\xDE' };
+    capture.OnData(now, noise, sizeof(noise));
+    CHECK(CountEvents(result, "Trigger bytes") == 0 && !capture.TakeEvent(error));
+    const char tail[] = { '\xAD', '\xBE' };
+    capture.OnData(now += 10, tail, sizeof(tail));
+    CHECK(!capture.TakeEvent(error));
+    const char last[] = { '\xEF', '\0' };
+    capture.OnData(now += 10, last, sizeof(last));
+    Drain(capture, result);
+    CHECK(CountEvents(result, "Trigger bytes DE AD be ef: capturing") == 1);
+    capture.Close();
+    Drain(capture, result);
+    for (const std::string& path : result.files) remove(path.c_str());
+}
+
+static bool SpecError(const char* spec, const char* expect)
+{
+    TriggerConfig config;
+    std::string error;
+    return !ParseTriggerSpec(spec, config, error) && error == expect;
+}
+
+static void TestParse()
+{
+    TriggerConfig config;
+    std::string error;
+    CHECK(ParseTriggerSpec("", config, error) && config.Empty());
+    CHECK(ParseTriggerSpec(" ; ;", config, error) && config.Empty());
+    CHECK(ParseTriggerSpec("silence:250ms; pre:5; post:1.5s; rate:2K; ring:2M", config, error));
+    CHECK(config.silenceMs == 250 && config.preMs == 5000 && config.postMs == 1500);
+    CHECK(config.rateBytesPerSec == 2048 && config.ringBytes == 2 * 1024 * 1024);
+    CHECK(ParseTriggerSpec("silence:2s; pre:100ms", config, error));
+    CHECK(config.silenceMs == 2000 && config.preMs == 100);
+    CHECK(ParseTriggerSpec("silence:500", config, error) && config.silenceMs == 500);   // ms by default
+    CHECK(ParseTriggerSpec("text:a;b", config, error) == false);                       // ';' always separates
+
+    CHECK(SpecError("PANIC", "missing ':' in \"PANIC\""));
+    CHECK(SpecError("text:x; panic:1", "unknown trigger \"panic\""));
+    CHECK(SpecError("text:", "bad value for \"text\""));
+    CHECK(SpecError("bytes:DE A", "bad value for \"bytes\""));
+    CHECK(SpecError("bytes:XY", "bad value for \"bytes\""));
+    CHECK(SpecError("bytes:", "bad value for \"bytes\""));
+    CHECK(SpecError("silence:0", "bad value for \"silence\""));
+    CHECK(SpecError("silence:soon", "bad value for \"silence\""));
+    CHECK(SpecError("rate:0", "bad value for \"rate\""));
+    CHECK(SpecError("rate:-5", "bad value for \"rate\""));
+    CHECK(SpecError("pre:x", "bad value for \"pre\""));
+    CHECK(SpecError("post:-1", "bad value for \"post\""));
+    CHECK(SpecError("ring:1K", "bad value for \"ring\""));
+    CHECK(SpecError("ring:512M", "bad value for \"ring\""));
+}
+
+int main()
+{
+    TestRingWrap();
+    TestMatcherOverlaps();
+    TestReplay();
+    TestRate();
+    TestBytes();
+    TestParse();
+    return CheckResult();
+}
@@ -0,0 +1,74 @@
+// ExporterBench.cpp : export throughput per format from a generated capture file
+//
+//   ExporterBench [millions of lines=10]
+// Lines look like device telemetry (a few templates with changing numbers),
+// which is what the columnar dictionary is built for.
+
+#include "Exporter.h"
+#include <chrono>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+static long long FileSize(const char* path)
+{
+#ifdef _WIN32
+    struct _stat64 st;
+    return _stat64(path, &st) == 0 ? (long long)st.st_size : 0;
+#else
+    struct stat st;
+    return stat(path, &st) == 0 ? (long long)st.st_size : 0;
+#endif
+}
+
+int main(int argc, char** argv)
+{
+    size_t lines = (size_t)((argc > 1 ? atof(argv[1]) : 10) * 1000000);
+    const char* source = "bench_export_source.txt";
+    uint64_t base = 1700000000000ULL;
+    {
+        CaptureWriter writer;
+        if (!writer.Open(source)) { fprintf(stderr, "cannot create %s\n", source); return 1; }
+        char text[96];
+        for (size_t i = 0; i < lines; i++) {
+            int n;
+            switch (i % 4) {
+            case 0: n = snprintf(text, sizeof(text), "temp=%d.%d C fan=%d rpm", 40 + (int)(i % 7), (int)(i % 10), 1200 + (int)(i % 300)); break;
+            case 1: n = snprintf(text, sizeof(text), "status ok"); break;
+            case 2: n = snprintf(text, sizeof(text), "seq %zu ack", i); break;
+            default: n = snprintf(text, sizeof(text), "adc ch%d = %d", (int)(i % 8), (int)(i * 37 % 4096)); break;
+            }
+            writer.WriteLine(base + i * 3, text, (size_t)n);
+        }
+    }
+    double sourceMb = FileSize(source) / 1e6;
+    printf("%zu lines, %.0f MB capture\n", lines, sourceMb);
+
+    struct { ExportFormat format; const char* target; const char* name; } runs[] = {
+        { EF_CSV, "bench_export.csv", "csv" },
+        { EF_JSONL, "bench_export.jsonl", "jsonl" },
+        { EF_COLUMNAR, "bench_export.smcol", "columnar" },
+    };
+    for (const auto& run : runs) {
+        for (int ranged = 0; ranged < 2; ranged++) {
+            ExportRequest request;
+            request.sourcePath = source;
+            request.targetPath = run.target;
+            request.format = run.format;
+            if (ranged) {
+                // Middle tenth of the capture
+                request.fromMs = base + lines * 3 * 45 / 100;
+                request.toMs = base + lines * 3 * 55 / 100;
+            }
+            ExportStatus status;
+            auto start = std::chrono::steady_clock::now();
+            bool ok = RunExport(request, status);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            printf("%-8s %-6s %s %9llu rows in %.2f s = %5.2f M lines/s in, %4.0f MB/s in, output %.0f MB\n", run.name,
+                ranged ? "range" : "all", ok ? "ok " : "ERR", (unsigned long long)status.rows.load(), seconds,
+                lines / seconds / 1e6, sourceMb / seconds, FileSize(run.target) / 1e6);
+            remove(run.target);
+        }
+    }
+    remove(source);
+    return 0;
+}
@@ -0,0 +1,275 @@
+// ExporterTest.cpp : CSV/JSONL/columnar output and the --from/--to range
+//
+
+#include "Exporter.h"
+#include "TestCheck.h"
+#include <stdlib.h>
+#include <string.h>
+
+static std::string ReadAll(const char* path)
+{
+    std::string text;
+    FILE* f = fopen(path, "rb");
+    if (!f) return text;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+    fclose(f);
+    return text;
+}
+
+static bool Exists(const char* path)
+{
+    FILE* f = fopen(path, "rb");
+    if (f) fclose(f);
+    return f != nullptr;
+}
+
+static size_t CountLines(const std::string& text)
+{
+    size_t n = 0;
+    for (char c : text) if (c == '\n') n++;
+    return n;
+}
+
+// Bounds-checked reads over a whole file held in memory.
+struct ByteCursor {
+    const std::string& data;
+    size_t at;
+    bool ok = true;
+    ByteCursor(const std::string& d, size_t start) : data(d), at(start) {}
+    const char* Take(size_t n)
+    {
+        if (!ok || at > data.size() || data.size() - at < n) { ok = false; return nullptr; }
+        at += n;
+        return data.data() + at - n;
+    }
+    bool Tag(const char* tag) { const char* p = Take(4); return p && memcmp(p, tag, 4) == 0; }
+    uint32_t U32() { uint32_t v = 0; if (const char* p = Take(4)) memcpy(&v, p, 4); return v; }
+    uint64_t U64() { uint64_t v = 0; if (const char* p = Take(8)) memcpy(&v, p, 8); return v; }
+    uint64_t Varint()
+    {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const char* p = Take(1);
+            if (!p) return 0;
+            v |= (uint64_t)(*p & 0x7F) << shift;
+            if (!(*p & 0x80)) return v;
+        }
+        ok = false;
+        return 0;
+    }
+};
+
+// Independent SMCOL1 reader: walks the index in the trailer and rebuilds every
+// row from its block's timestamp deltas, dictionary ids, offsets and blob.
+static bool DecodeColumnar(const std::string& file, std::vector<CaptureLine>& rows, size_t& blockCount)
+{
+    rows.clear();
+    if (file.size() < 32 || memcmp(file.data(), "SMCOL1\0\0", 8) != 0 || file.compare(file.size() - 8, 8, "SMCOLEND") != 0) return false;
+    ByteCursor trailer(file, file.size() - 24);
+    uint64_t indexOffset = trailer.U64(), totalRows = trailer.U64();
+    ByteCursor index(file, (size_t)indexOffset);
+    if (!index.Tag("IDX1")) return false;
+    blockCount = index.U32();
+    for (size_t b = 0; b < blockCount; b++) {
+        ByteCursor block(file, (size_t)index.U64());
+        if (!index.ok || !block.Tag("BLK1")) return false;
+        uint32_t count = block.U32(), dictCount = block.U32(), tsBytes = block.U32(), idBytes = block.U32(), blobBytes = block.U32();
+        uint64_t time = block.U64();
+        size_t tsStart = block.at;
+        std::vector<uint64_t> times;
+        for (uint32_t i = 0; i < count; i++) {
+            uint64_t zigzag = block.Varint();
+            time += (uint64_t)((int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1));
+            times.push_back(time);
+        }
+        if (block.at != tsStart + tsBytes) return false;
+        std::vector<uint64_t> ids;
+        for (uint32_t i = 0; i < count; i++) ids.push_back(block.Varint());
+        if (block.at != tsStart + tsBytes + idBytes) return false;
+        std::vector<uint32_t> offsets;
+        for (uint32_t i = 0; i <= dictCount; i++) offsets.push_back(block.U32());
+        const char* blob = block.Take(blobBytes);
+        if (!block.ok || offsets.back() != blobBytes) return false;
+        for (uint32_t i = 0; i < count; i++) {
+            if (ids[i] >= dictCount || offsets[ids[i]] > offsets[ids[i] + 1]) return false;
+            rows.push_back({ times[i], std::string(blob + offsets[ids[i]], offsets[ids[i] + 1] - offsets[ids[i]]) });
+        }
+    }
+    return index.ok && index.at == file.size() - 24 && rows.size() == totalRows;
+}
+
+static bool SameLines(const std::vector<CaptureLine>& a, const std::vector<CaptureLine>& b)
+{
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].timeMs != b[i].timeMs || a[i].text != b[i].text) return false;
+    }
+    return true;
+}
+
+static bool Export(ExportRequest request, ExportFormat format, const char* target, uint64_t& rows)
+{
+    request.format = format;
+    request.targetPath = target;
+    ExportStatus status;
+    bool ok = RunExport(request, status);
+    rows = status.rows;
+    return ok && status.permille == 1000;
+}
+
+static void TestParseTime()
+{
+    uint64_t start = 0, end = 0, exact = 0, iso = 0;
+    CHECK(ParseExportTime("2023-11-14 22:13:20", false, start));
+    CHECK(ParseExportTime("2023-11-14 22:13:20", true, end));
+    CHECK(end == start + 999);
+    CHECK(ParseExportTime("2023-11-14 22:13:20.250", true, exact));
+    CHECK(exact == start + 250);
+    CHECK(ParseExportTime("2023-11-14T22:13:20", false, iso));
+    CHECK(iso == start);
+    uint64_t t;
+    CHECK(!ParseExportTime("", false, t));
+    CHECK(!ParseExportTime("2023-11-14", false, t));
+    CHECK(!ParseExportTime("2023-11-14 22:13", false, t));
+    CHECK(!ParseExportTime("yesterday at noon!!", false, t));
+
+    CHECK(ExportFormatForPath("out.csv") == EF_CSV);
+    CHECK(ExportFormatForPath("C:\\data\\out.JSONL") == EF_JSONL);
+    CHECK(ExportFormatForPath("out.smcol") == EF_COLUMNAR);
+    CHECK(ExportFormatForPath("out") == EF_CSV);
+}
+
+static void TestFormatsAndRange()
+{
+    uint64_t base;
+    CHECK(ParseExportTime("2023-11-14 22:13:20", false, base));
+    const char* texts[] = { "plain", "a,b", "say \"hi\"", "tab\there", "bad \xFF byte", "back\\slash" };
+    {
+        CaptureWriter writer;
+        CHECK(writer.Open("export_source.txt"));
+        for (int i = 0; i < 6; i++) writer.WriteLine(base + i * 1000, texts[i], strlen(texts[i]));
+    }
+    ExportRequest request;
+    request.sourcePath = "export_source.txt";
+    uint64_t rows = 0;
+
+    CHECK(Export(request, EF_CSV, "export_all.csv", rows));
+    CHECK(rows == 6);
+    std::string csv = ReadAll("export_all.csv");
+    CHECK(csv.compare(0, 18, "time,time_ms,text\n") == 0);
+    CHECK(CountLines(csv) == 7);
+    CHECK(csv.find(",\"a,b\"\n") != std::string::npos);
+    CHECK(csv.find(",\"say \"\"hi\"\"\"\n") != std::string::npos);
+    CHECK(csv.find("," + std::to_string(base + 1000) + ",") != std::string::npos);
+
+    CHECK(Export(request, EF_JSONL, "export_all.jsonl", rows));
+    std::string jsonl = ReadAll("export_all.jsonl");
+    CHECK(CountLines(jsonl) == 6);
+    CHECK(jsonl.find("\"text\":\"say \\\"hi\\\"\"") != std::string::npos);
+    CHECK(jsonl.find("\"text\":\"tab\\there\"") != std::string::npos);
+    CHECK(jsonl.find("\"text\":\"bad \xEF\xBF\xBD byte\"") != std::string::npos);
+    CHECK(jsonl.find("\"text\":\"back\\\\slash\"") != std::string::npos);
+
+    // Inclusive range: rows 1..3
+    request.fromMs = base + 1000;
+    CHECK(ParseExportTime("2023-11-14 22:13:23", true, request.toMs));
+    CHECK(Export(request, EF_CSV, "export_range.csv", rows));
+    CHECK(rows == 3);
+    csv = ReadAll("export_range.csv");
+    CHECK(CountLines(csv) == 4);
+    CHECK(csv.find("plain") == std::string::npos && csv.find("a,b") != std::string::npos);
+    CHECK(csv.find("tab\there") != std::string::npos && csv.find("bad") == std::string::npos);
+
+    CHECK(Export(request, EF_COLUMNAR, "export_range.smcol", rows));
+    std::string col = ReadAll("export_range.smcol");
+    CHECK(col.size() > 32 && memcmp(col.data(), "SMCOL1\0\0", 8) == 0);
+    CHECK(col.size() > 32 && col.compare(col.size() - 8, 8, "SMCOLEND") == 0);
+    std::vector<CaptureLine> decoded;
+    size_t blocks = 0;
+    CHECK(DecodeColumnar(col, decoded, blocks));
+    CHECK(blocks == 1 && decoded.size() == 3);
+    for (size_t i = 0; i < decoded.size() && i < 3; i++) {
+        CHECK(decoded[i].timeMs == base + (i + 1) * 1000 && decoded[i].text == texts[i + 1]);
+    }
+
+    // Scrollback snapshot instead of a file
+    ExportRequest scrollback;
+    for (int i = 0; i < 6; i++) scrollback.lines.push_back({ base + i * 1000, texts[i] });
+    scrollback.toMs = base + 1999;
+    CHECK(Export(scrollback, EF_JSONL, "export_scrollback.jsonl", rows));
+    CHECK(rows == 2);
+
+    // Missing source
+    ExportRequest missing;
+    missing.sourcePath = "export_missing.txt";
+    CHECK(!Export(missing, EF_CSV, "export_none.csv", rows));
+
+    for (const char* path : { "export_source.txt", "export_all.csv", "export_all.jsonl", "export_range.csv",
+        "export_range.smcol", "export_scrollback.jsonl", "export_none.csv" }) {
+        remove(path);
+    }
+}
+
+// Several blocks, repeated and unique texts, binary bytes and timestamps that
+// jump backwards, all decoded back to the source rows.
+static void TestColumnarRoundTrip()
+{
+    ExportRequest request;
+    srand(28);
+    uint64_t time = 1700000000000ULL;
+    const char* templates[] = { "status ok", "", "temp=41.5 C", "a\0b", "\xFF\xFE raw" };
+    for (size_t i = 0; i < 150000; i++) {
+        int r = rand() % 100;
+        if (r < 3) time -= rand() % 5000;               // clock stepped back
+        else if (r < 4) time += 86400000ULL * (1 + rand() % 30);
+        else time += rand() % 20;
+        std::string text = r < 60 ? std::string(templates[r % 5], r % 5 == 3 ? 3 : strlen(templates[r % 5]))
+            : "seq " + std::to_string(i) + " adc=" + std::to_string(rand() % 4096);
+        request.lines.push_back({ time, text });
+    }
+    uint64_t rows = 0;
+    CHECK(Export(request, EF_COLUMNAR, "export_roundtrip.smcol", rows));
+    CHECK(rows == request.lines.size());
+    std::vector<CaptureLine> decoded;
+    size_t blocks = 0;
+    CHECK(DecodeColumnar(ReadAll("export_roundtrip.smcol"), decoded, blocks));
+    CHECK(blocks == (request.lines.size() + COLUMNAR_BLOCK_ROWS - 1) / COLUMNAR_BLOCK_ROWS);
+    CHECK(SameLines(decoded, request.lines));
+    remove("export_roundtrip.smcol");
+}
+
+// A cancelled export leaves neither a partial target nor its side file, and an
+// existing target survives untouched.
+static void TestCancelLeavesNoFile()
+{
+    FILE* f = fopen("export_cancel.csv", "wb");
+    CHECK(f != nullptr);
+    if (f) { fputs("previous export\n", f); fclose(f); }
+    ExportRequest request;
+    for (int i = 0; i < 20000; i++) request.lines.push_back({ 1700000000000ULL + i, "row " + std::to_string(i) });
+    request.targetPath = "export_cancel.csv";
+    ExportStatus status;
+    status.cancel = true;
+    CHECK(!RunExport(request, status));
+    CHECK(status.error == "cancelled");
+    CHECK(ReadAll("export_cancel.csv") == "previous export\n");
+    CHECK(!Exists("export_cancel.csv.part"));
+
+    // The same export without cancelling replaces it
+    status.cancel = false;
+    CHECK(RunExport(request, status));
+    CHECK(CountLines(ReadAll("export_cancel.csv")) == 20001);
+    CHECK(!Exists("export_cancel.csv.part"));
+    remove("export_cancel.csv");
+}
+
+int main()
+{
+    TestParseTime();
+    TestFormatsAndRange();
+    TestColumnarRoundTrip();
+    TestCancelLeavesNoFile();
+    return CheckResult();
+}
@@ -0,0 +1,53 @@
+// LineFolderBench.cpp : cost per line and UI rows left after folding
+//
+//   LineFolderBench [millions of lines=2]
+// The display stage posts one row per line that does not fold, so rows per
+// input line is what the UI thread has to keep up with.
+
+#include "LineFolder.h"
+#include <chrono>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+struct Stream {
+    const char* name;
+    std::vector<std::string> lines;
+};
+
+int main(int argc, char** argv)
+{
+    size_t count = (size_t)((argc > 1 ? atof(argv[1]) : 2) * 1000000);
+    Stream streams[3] = { { "varied", {} }, { "identical", {} }, { "counters", {} } };
+    const char* words[] = { "init", "sensor", "ready", "timeout", "retry", "flash", "reset", "config", "link", "ack", "nack" };
+    for (size_t i = 0; i < count; i++) {
+        char text[96];
+        // Consecutive lines differ in their words, not just their numbers
+        snprintf(text, sizeof(text), "%s %s %s %zu\r\n", words[i % 11], words[i / 11 % 7], words[i / 77 % 5], i);
+        streams[0].lines.push_back(text);
+        // Bursts of the same message, 100 at a time
+        snprintf(text, sizeof(text), "link down on port %zu\r\n", i / 100 % 4);
+        streams[1].lines.push_back(text);
+        snprintf(text, sizeof(text), "temp=%zu.%zu C fan=%zu rpm uptime=%zu\r\n", 40 + i % 9, i % 10, 1200 + i % 400, i);
+        streams[2].lines.push_back(i % 100 == 99 ? "heartbeat\r\n" : text);
+    }
+
+    const FoldMode modes[] = { FOLD_OFF, FOLD_EXACT, FOLD_TEMPLATE };
+    const char* modeNames[] = { "off", "exact", "template" };
+    for (const Stream& stream : streams) {
+        for (int m = 0; m < 3; m++) {
+            LineFolder folder;
+            folder.SetMode(modes[m]);
+            size_t rows = 0;
+            auto start = std::chrono::steady_clock::now();
+            uint64_t t = 0;
+            for (const std::string& line : stream.lines) {
+                if (!folder.Add(t++, line.data(), line.size())) rows++;
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            printf("%-10s %-9s %8zu lines -> %8zu rows (%6.1fx fewer), %5.1f ns/line\n", stream.name, modeNames[m],
+                stream.lines.size(), rows, (double)stream.lines.size() / rows, seconds * 1e9 / stream.lines.size());
+        }
+    }
+    return 0;
+}
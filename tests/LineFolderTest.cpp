@@ -0,0 +1,68 @@
+// LineFolderTest.cpp : run detection in exact and template mode
+//
+
+#include "LineFolder.h"
+#include "TestCheck.h"
+#include <string.h>
+
+static bool Add(LineFolder& folder, uint64_t timeMs, const char* text)
+{
+    return folder.Add(timeMs, text, strlen(text));
+}
+
+static void TestOff()
+{
+    LineFolder folder;
+    CHECK(!Add(folder, 1, "same\n"));
+    CHECK(!Add(folder, 2, "same\n"));
+    CHECK(folder.Count() == 0);
+}
+
+static void TestExact()
+{
+    LineFolder folder;
+    folder.SetMode(FOLD_EXACT);
+    CHECK(!Add(folder, 100, "ping\r\n"));
+    CHECK(Add(folder, 110, "ping\n"));        // line endings do not count
+    CHECK(Add(folder, 125, "ping"));
+    CHECK(folder.Count() == 3);
+    CHECK(folder.FirstMs() == 100 && folder.LastMs() == 125);
+    CHECK(!Add(folder, 130, "ping 2\n"));     // exact mode keeps numbers apart
+    CHECK(folder.Count() == 1 && folder.FirstMs() == 130);
+    CHECK(!Add(folder, 140, "ping\n"));
+    CHECK(!Add(folder, 150, "Ping\n"));
+    CHECK(!Add(folder, 160, ""));
+    CHECK(Add(folder, 170, "\r\n"));           // blank lines fold with each other
+}
+
+static void TestTemplate()
+{
+    LineFolder folder;
+    folder.SetMode(FOLD_TEMPLATE);
+    CHECK(!Add(folder, 1, "temp=41.5 C fan=1200\n"));
+    CHECK(Add(folder, 2, "temp=42.25 C fan=980\n"));
+    CHECK(Add(folder, 3, "temp=7 C fan=0\n"));
+    CHECK(folder.Count() == 3 && folder.FirstMs() == 1 && folder.LastMs() == 3);
+    CHECK(!Add(folder, 4, "temp=7 F fan=0\n"));        // text around the numbers differs
+    CHECK(!Add(folder, 5, "v1.2.3 ready\n"));
+    CHECK(Add(folder, 6, "v10.20.30 ready\n"));        // dotted numbers are one run
+    CHECK(!Add(folder, 7, "v1. ready\n"));             // a trailing dot is text
+
+    CHECK(LineFolder::Hash("a1b", 3, true) == LineFolder::Hash("a999b", 5, true));
+    CHECK(LineFolder::Hash("a1b", 3, false) != LineFolder::Hash("a999b", 5, false));
+    CHECK(LineFolder::Hash("1.5", 3, true) == LineFolder::Hash("7", 1, true));
+
+    // Switching mode starts over
+    folder.SetMode(FOLD_EXACT);
+    CHECK(folder.Count() == 0);
+    CHECK(!Add(folder, 8, "v10.20.30 ready\n"));
+    CHECK(!Add(folder, 9, "v1.2.3 ready\n"));
+}
+
+int main()
+{
+    TestOff();
+    TestExact();
+    TestTemplate();
+    return CheckResult();
+}
@@ -0,0 +1,127 @@
+// LogQueryBench.cpp : literal and regex queries over a generated multi-GB log folder
+//
+//   LogQueryBench [gigabytes=4] [files=32]
+// Writes <files> raw logs totalling <gigabytes> into bench_query_logs, then
+// runs every query three ways:
+//   cold      each file dropped from the page cache first (Linux only), no .query-cache
+//   no-cache  files in the page cache, .query-cache disabled: the raw scan speed
+//   warm      .query-cache in place, files unchanged, so nothing is rescanned
+// The folder is deleted afterwards.
+
+#include "LogQuery.h"
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+#ifdef _WIN32
+#include <direct.h>
+#define MakeDir(path) _mkdir(path)
+#define RemoveDir(path) _rmdir(path)
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#define MakeDir(path) mkdir(path, 0755)
+#define RemoveDir(path) rmdir(path)
+#endif
+
+static const char* FOLDER = "bench_query_logs";
+
+// Returns false where the page cache cannot be dropped per file.
+static bool EvictFromCache(const std::string& path)
+{
+#if defined(__linux__)
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    fdatasync(fd);
+    bool ok = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(fd);
+    return ok;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+static void WriteLog(const std::string& path, uint64_t bytes, uint64_t& lineNo)
+{
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) { fprintf(stderr, "cannot create %s\n", path.c_str()); exit(1); }
+    std::string buf;
+    char line[128];
+    for (uint64_t written = 0; written < bytes;) {
+        uint64_t i = lineNo++;
+        int n;
+        // Telemetry with a rare fault roughly every 400k lines
+        if (i % 400009 == 17) n = snprintf(line, sizeof(line), "WATCHDOG RESET after %u ms\r\n", (unsigned)(i % 5000));
+        else if (i % 100003 == 5) n = snprintf(line, sizeof(line), "Error: code 0x%02X in task %u\r\n", (unsigned)(i % 256), (unsigned)(i % 16));
+        else switch (i % 4) {
+        case 0: n = snprintf(line, sizeof(line), "temp=%u.%u C fan=%u rpm\r\n", 40 + (unsigned)(i % 7), (unsigned)(i % 10), 1200 + (unsigned)(i % 300)); break;
+        case 1: n = snprintf(line, sizeof(line), "status ok, uptime %llu s\r\n", (unsigned long long)(i / 100)); break;
+        case 2: n = snprintf(line, sizeof(line), "seq %llu ack\r\n", (unsigned long long)i); break;
+        default: n = snprintf(line, sizeof(line), "adc ch%u = %u\r\n", (unsigned)(i % 8), (unsigned)(i * 37 % 4096)); break;
+        }
+        buf.append(line, (size_t)n);
+        written += (uint64_t)n;
+        if (buf.size() >= 1024 * 1024) { fwrite(buf.data(), 1, buf.size(), f); buf.clear(); }
+    }
+    fwrite(buf.data(), 1, buf.size(), f);
+    fclose(f);
+}
+
+int main(int argc, char** argv)
+{
+    double gigabytes = argc > 1 ? atof(argv[1]) : 4;
+    int fileCount = argc > 2 ? atoi(argv[2]) : 32;
+    if (gigabytes <= 0 || fileCount < 1) { fprintf(stderr, "usage: LogQueryBench [gigabytes] [files]\n"); return 2; }
+    uint64_t perFile = (uint64_t)(gigabytes * 1e9 / fileCount);
+
+    MakeDir(FOLDER);
+    std::vector<std::string> paths;
+    uint64_t lineNo = 0;
+    for (int i = 0; i < fileCount; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "log_COM%d_2023-11-%02d_%02d-00-00.txt", 3 + i % 4, 1 + i / 24 % 28, i % 24);
+        paths.push_back(std::string(FOLDER) + "/" + name);
+        WriteLog(paths.back(), perFile, lineNo);
+    }
+    printf("%d files, %.2f GB, %llu lines\n", fileCount, perFile * fileCount / 1e9, (unsigned long long)lineNo);
+
+    struct { const char* name; const char* pattern; bool regex; bool ignoreCase; } queries[] = {
+        { "literal", "WATCHDOG RESET", false, false },
+        { "literal icase", "watchdog reset", false, true },
+        { "regex", "RESET after \\d+ ms", true, false },
+        { "regex icase", "code 0x[0-9a-f]+ in task 1[0-5]", true, true },
+    };
+    std::string cachePath = std::string(FOLDER) + "/.query-cache";
+    bool allEvicted = true;
+    for (const auto& q : queries) {
+        for (int mode = 0; mode < 3; mode++) {
+            QueryOptions options;
+            options.pattern = q.pattern;
+            options.regex = q.regex;
+            options.ignoreCase = q.ignoreCase;
+            options.useCache = mode != 1;
+            const char* label = mode == 0 ? "cold" : mode == 1 ? "no-cache" : "warm";
+            if (mode == 0) {
+                remove(cachePath.c_str());
+                bool evicted = true;
+                for (const std::string& path : paths) evicted = EvictFromCache(path) && evicted;
+                if (!evicted) { label = "cold*"; allEvicted = false; }
+            }
+            std::vector<QueryMatch> results;
+            QueryStats stats;
+            std::string error;
+            if (!RunLogQuery(FOLDER, options, results, stats, error)) { fprintf(stderr, "%s: %s\n", q.pattern, error.c_str()); return 1; }
+            printf("%-14s %-9s %5zu matches, %2zu/%zu files scanned, %6.2f GB in %7.3f s = %5.2f GB/s\n", q.name, label,
+                results.size(), stats.filesScanned, stats.filesTotal, stats.bytesScanned / 1e9, stats.seconds,
+                stats.seconds > 0 ? stats.bytesScanned / 1e9 / stats.seconds : 0.0);
+        }
+    }
+    if (!allEvicted) printf("cold* = the page cache could not be dropped here, so these ran warm\n");
+
+    for (const std::string& path : paths) remove(path.c_str());
+    remove(cachePath.c_str());
+    RemoveDir(FOLDER);
+    return 0;
+}
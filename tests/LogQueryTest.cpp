@@ -0,0 +1,376 @@
+// LogQueryTest.cpp : literal search, regex prefilter, multi-file ordering and the result cache
+//
+
+#include "LogQuery.h"
+#include "TestCheck.h"
+#include <regex>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#include <sys/utime.h>
+#define MakeDir(path) _mkdir(path)
+#define RemoveDir(path) _rmdir(path)
+#define utimbuf _utimbuf
+#define utime _utime
+#else
+#include <utime.h>
+#include <unistd.h>
+#define MakeDir(path) mkdir(path, 0755)
+#define RemoveDir(path) rmdir(path)
+#endif
+
+static const char* FOLDER = "query_logs";
+static const char* LOG_NAME = "log_COM7_2023-11-14_22-13-20.txt";
+
+static bool WriteLines(const std::string& path, const std::vector<std::string>& lines, const char* eol = "\n", bool lastEol = true)
+{
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    for (size_t i = 0; i < lines.size(); i++) {
+        fwrite(lines[i].data(), 1, lines[i].size(), f);
+        if (lastEol || i + 1 < lines.size()) fputs(eol, f);
+    }
+    fclose(f);
+    return true;
+}
+
+static bool Query(const std::string& folder, QueryOptions options, std::vector<QueryMatch>& results, QueryStats& stats)
+{
+    std::string error;
+    bool ok = RunLogQuery(folder, options, results, stats, error);
+    if (!ok) fprintf(stderr, "query \"%s\" failed: %s\n", options.pattern.c_str(), error.c_str());
+    return ok;
+}
+
+static std::string Lower(std::string s)
+{
+    for (char& c : s) if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+    return s;
+}
+
+static std::vector<std::string> Corpus()
+{
+    std::vector<std::string> lines = {
+        "ABC at start", "xABCy", "abc lower", "x*y star", "a\tfoo tabbed", "abab cd", "ababcd",
+        "temp=42.5 C", "seq 1234 ack", "err.7 raised", "foo+bar", "a/b path", "word boundary", "swordfish",
+        "AAA", "\x01" "ctrl-a", "100ms late", "[bracket]", "(paren)", "dollar$sign", "caret^here", "{brace}",
+        "back\\slash", "tilde~", "A1B2C3", "aaaa", "Error: code 0x1F", "WARNING low battery", "ok",
+    };
+    const char* words[] = { "abc", "ABC", "x", "*", "y", "12", "ms", "err", ".", "foo", "+", "bar", "\t", "A", "b" };
+    srand(29);
+    for (int i = 0; i < 2000; i++) {
+        std::string line;
+        int n = 1 + rand() % 6;
+        for (int k = 0; k < n; k++) line += words[rand() % 15];
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+// Runs the query and compares its line numbers with std::regex applied to every line.
+static bool Consistent(const std::vector<std::string>& lines, const std::string& pattern, bool ignoreCase)
+{
+    std::regex re;
+    bool compiles = true;
+    try {
+        auto flags = std::regex::ECMAScript;
+        if (ignoreCase) flags |= std::regex::icase;
+        re = std::regex(pattern, flags);
+    }
+    catch (const std::regex_error&) {
+        compiles = false;
+    }
+    QueryOptions options;
+    options.pattern = pattern;
+    options.regex = true;
+    options.ignoreCase = ignoreCase;
+    options.useCache = false;
+    options.maxResults = 100000;
+    std::vector<QueryMatch> results;
+    QueryStats stats;
+    std::string error;
+    bool ran = RunLogQuery(FOLDER, options, results, stats, error);
+    if (!compiles) return !ran;
+    if (!ran) return false;
+
+    std::vector<uint32_t> expected, actual;
+    for (size_t i = 0; i < lines.size(); i++) {
+        if (std::regex_search(lines[i], re)) expected.push_back((uint32_t)i + 1);
+    }
+    for (const QueryMatch& m : results) actual.push_back(m.line);
+    if (expected != actual) {
+        fprintf(stderr, "pattern \"%s\"%s: %zu expected, %zu found\n", pattern.c_str(), ignoreCase ? " (icase)" : "",
+            expected.size(), actual.size());
+        return false;
+    }
+    return true;
+}
+
+static std::string RandomRegex()
+{
+    static const char* atoms[] = {
+        "a", "b", "c", "A", "B", "x", "y", "1", "2", "m", "s",
+        "\\x41", "\\x61", "\\x2A", "\\u0041", "\\u0062", "\\cI", "\\cA", "\\d", "\\w", "\\s", "\\b",
+        "\\.", "\\*", "\\+", "\\/", "\\\\", "\\t", "[ab]", "[0-9]", "[^x]", ".", "(ab)", "(a|b)", "(?:c)",
+    };
+    static const char* quantifiers[] = { "", "", "", "", "?", "*", "+", "{2}", "{0,1}" };
+    std::string re;
+    int n = 1 + rand() % 5;
+    for (int k = 0; k < n; k++) {
+        re += atoms[rand() % (sizeof(atoms) / sizeof(atoms[0]))];
+        re += quantifiers[rand() % (sizeof(quantifiers) / sizeof(quantifiers[0]))];
+    }
+    if (re.find('(') != std::string::npos && rand() % 3 == 0) re += "\\1";
+    return re;
+}
+
+static void TestRegexPrefilter()
+{
+    MakeDir(FOLDER);
+    std::vector<std::string> lines = Corpus();
+    std::string path = std::string(FOLDER) + "/" + LOG_NAME;
+    bool written = WriteLines(path, lines, "\r\n");
+    CHECK(written);
+    if (!written) return;
+
+    uint64_t t;
+    CHECK(ParseLogFileTime(LOG_NAME, t));
+    CHECK(!ParseLogFileTime("capture_COM7_2023-11-14_22-13-20-000.txt", t));
+
+    // Escapes whose operands used to leak into the prefilter literal
+    const char* patterns[] = {
+        "\\x41BC", "x\\x2Ay", "\\u0041BC", "\\u0061bc", "a\\cIfoo", "\\cAct", "(ab)\\1cd", "(ab)\\1+cd",
+        "\\d+ms", "err\\.\\d", "temp=\\d+\\.\\d C", "foo\\+bar", "a\\/b", "\\bword\\b", "\\[bracket\\]",
+        "\\(paren\\)", "dollar\\$sign", "caret\\^here", "\\{brace\\}", "back\\\\slash", "0x[0-9A-F]+",
+        "[0-9]{3}abc", "a?bcd", "ab*cd", "A\\d?B", "^ok$", "WARNING", "\\x41{3}", "\\u0041\\u0041A",
+    };
+    for (const char* pattern : patterns) {
+        CHECK(Consistent(lines, pattern, false));
+        CHECK(Consistent(lines, pattern, true));
+    }
+    int failures = 0;
+    for (int i = 0; i < 400 && failures < 5; i++) {
+        std::string pattern = RandomRegex();
+        if (!Consistent(lines, pattern, i % 2 == 1)) failures++;
+    }
+    CHECK(failures == 0);
+
+    remove(path.c_str());
+    remove((std::string(FOLDER) + "/.query-cache").c_str());
+    RemoveDir(FOLDER);
+}
+
+// The 16-byte literal scan against a naive per-line search. Lines of every
+// length put hits at every offset relative to the 16-byte blocks, and the
+// alphabet holds the pairs that only differ in bit 0x20 ('@' '`', '[' '{').
+static void TestLiteral()
+{
+    const char* folder = "query_literal";
+    MakeDir(folder);
+    std::string path = std::string(folder) + "/log_COM1_2023-11-14_22-13-20.txt";
+    const char alphabet[] = "aAbBzZ@`[{-x";
+    srand(2901);
+    std::vector<std::string> lines;
+    for (int i = 0; i < 3000; i++) {
+        std::string line;
+        size_t len = i < 100 ? (size_t)i : (size_t)(rand() % 120);
+        for (size_t k = 0; k < len; k++) line.push_back(alphabet[rand() % 12]);
+        lines.push_back(line);
+    }
+    lines.push_back("tail needle at the very end of the file: [Ab@");
+    // No trailing newline, so a hit can end on the last byte of the mapping
+    bool written = WriteLines(path, lines, "\n", false);
+    CHECK(written);
+    if (!written) return;
+
+    std::vector<std::string> needles = { "a", "@", "`", "[{", "{[", "A@", "[Ab@", "zZzZ", "-x-x-" };
+    for (int i = 0; i < 150; i++) {
+        // Substrings of real lines, so most needles hit somewhere
+        const std::string& line = lines[100 + rand() % 2900];
+        if (line.empty()) continue;
+        size_t at = rand() % line.size();
+        size_t len = 1 + rand() % std::min<size_t>(line.size() - at, 40);
+        needles.push_back(line.substr(at, len));
+    }
+    int failures = 0;
+    for (const std::string& needle : needles) {
+        for (int icase = 0; icase < 2 && failures < 5; icase++) {
+            QueryOptions options;
+            options.pattern = needle;
+            options.ignoreCase = icase == 1;
+            options.useCache = false;
+            options.maxResults = 100000;
+            std::vector<QueryMatch> results;
+            QueryStats stats;
+            if (!Query(folder, options, results, stats)) { failures++; continue; }
+            std::vector<uint32_t> expected, actual;
+            for (size_t i = 0; i < lines.size(); i++) {
+                bool hit = icase ? Lower(lines[i]).find(Lower(needle)) != std::string::npos : lines[i].find(needle) != std::string::npos;
+                if (hit) expected.push_back((uint32_t)i + 1);
+            }
+            for (const QueryMatch& m : results) actual.push_back(m.line);
+            if (expected != actual) {
+                fprintf(stderr, "literal \"%s\"%s: %zu expected, %zu found\n", needle.c_str(), icase ? " (icase)" : "",
+                    expected.size(), actual.size());
+                failures++;
+            }
+            for (const QueryMatch& m : results) {
+                if (m.line < 1 || m.line > lines.size() || m.text != lines[m.line - 1]) { failures++; break; }
+            }
+        }
+    }
+    CHECK(failures == 0);
+    remove(path.c_str());
+    RemoveDir(folder);
+}
+
+// Files are scanned in parallel but results come back ordered by the log's
+// start time, then file name, then line, and maxResults keeps the newest.
+static void TestMultiFile()
+{
+    const char* folder = "query_multi";
+    MakeDir(folder);
+    std::vector<std::string> names;
+    for (int i = 0; i < 12; i++) {
+        char name[64];
+        // Out of order on disk; COM3 and COM4 share a start time
+        int minute = (i * 7) % 12;
+        snprintf(name, sizeof(name), "log_COM%d_2023-11-14_22-%02d-00.txt", i == 11 ? 4 : 3 + i % 2 * 5, i == 11 ? 0 : minute);
+        names.push_back(name);
+        std::vector<std::string> lines;
+        for (int k = 0; k < 200 + i * 37; k++) lines.push_back(k % 9 == 0 ? "tick HIT " + std::to_string(k) : "tick " + std::to_string(k));
+        CHECK(WriteLines(std::string(folder) + "/" + name, lines));
+    }
+
+    QueryOptions options;
+    options.pattern = "HIT";
+    options.useCache = false;
+    options.maxResults = 100000;
+    std::vector<QueryMatch> serial, parallel;
+    QueryStats stats;
+    options.threads = 1;
+    CHECK(Query(folder, options, serial, stats));
+    options.threads = 5;
+    CHECK(Query(folder, options, parallel, stats));
+    CHECK(stats.filesTotal == 12 && stats.filesScanned == 12);
+
+    size_t expectedHits = 0;
+    for (int i = 0; i < 12; i++) expectedHits += (200 + i * 37 + 8) / 9;
+    CHECK(serial.size() == expectedHits);
+    CHECK(parallel.size() == serial.size());
+    bool same = parallel.size() == serial.size(), ordered = true;
+    for (size_t i = 0; same && i < serial.size(); i++) {
+        same = serial[i].file == parallel[i].file && serial[i].line == parallel[i].line && serial[i].text == parallel[i].text;
+    }
+    for (size_t i = 1; i < parallel.size(); i++) {
+        const QueryMatch& a = parallel[i - 1];
+        const QueryMatch& b = parallel[i];
+        if (a.timeMs > b.timeMs || (a.timeMs == b.timeMs && (a.file > b.file || (a.file == b.file && a.line >= b.line)))) ordered = false;
+        if (b.text.compare(0, 9, "tick HIT ") != 0 || b.text.substr(9) != std::to_string(b.line - 1)) ordered = false;
+    }
+    CHECK(same);
+    CHECK(ordered);
+    CHECK(!parallel.empty() && parallel.front().file == "log_COM3_2023-11-14_22-00-00.txt");
+    CHECK(parallel.size() > 2 && parallel[1].file == "log_COM3_2023-11-14_22-00-00.txt");
+
+    // maxResults keeps the newest matches across all files
+    options.maxResults = 50;
+    std::vector<QueryMatch> newest;
+    CHECK(Query(folder, options, newest, stats));
+    CHECK(newest.size() == 50);
+    bool tail = newest.size() == 50 && serial.size() >= 50;
+    for (size_t i = 0; tail && i < 50; i++) {
+        const QueryMatch& want = serial[serial.size() - 50 + i];
+        tail = newest[i].file == want.file && newest[i].line == want.line;
+    }
+    CHECK(tail);
+    options.maxResults = 1;
+    CHECK(Query(folder, options, newest, stats));
+    CHECK(newest.size() == 1 && !serial.empty() && newest[0].line == serial.back().line && newest[0].file == serial.back().file);
+
+    for (const std::string& name : names) remove((std::string(folder) + "/" + name).c_str());
+    RemoveDir(folder);
+}
+
+static void SetMtime(const std::string& path, time_t t)
+{
+    utimbuf times;
+    times.actime = t;
+    times.modtime = t;
+    utime(path.c_str(), &times);
+}
+
+// Unchanged files come from .query-cache; a file that grew or whose mtime
+// changed is scanned again.
+static void TestCache()
+{
+    const char* folder = "query_cache";
+    MakeDir(folder);
+    std::string cachePath = std::string(folder) + "/.query-cache";
+    remove(cachePath.c_str());
+    std::vector<std::string> paths;
+    for (int i = 0; i < 4; i++) {
+        paths.push_back(std::string(folder) + "/log_COM9_2023-11-1" + std::to_string(i) + "_08-00-00.txt");
+        CHECK(WriteLines(paths[i], { "boot", "sensor fault " + std::to_string(i), "idle" }));
+        SetMtime(paths[i], 1700000000 + i);
+    }
+    QueryOptions options;
+    options.pattern = "FAULT";
+    options.ignoreCase = true;
+    std::vector<QueryMatch> results;
+    QueryStats stats;
+    CHECK(Query(folder, options, results, stats));
+    CHECK(stats.filesScanned == 4 && results.size() == 4);
+
+    std::vector<QueryMatch> again;
+    CHECK(Query(folder, options, again, stats));
+    CHECK(stats.filesTotal == 4 && stats.filesScanned == 0 && stats.bytesScanned == 0);
+    bool same = again.size() == results.size();
+    for (size_t i = 0; same && i < again.size(); i++) {
+        same = again[i].file == results[i].file && again[i].line == results[i].line && again[i].text == results[i].text &&
+            again[i].timeMs == results[i].timeMs;
+    }
+    CHECK(same);
+
+    // A different query does not reuse these results
+    options.ignoreCase = false;
+    CHECK(Query(folder, options, again, stats));
+    CHECK(stats.filesScanned == 4 && again.empty());
+    options.ignoreCase = true;
+
+    // The file grows
+    FILE* f = fopen(paths[1].c_str(), "ab");
+    if (f) { fputs("second fault\n", f); fclose(f); }
+    SetMtime(paths[1], 1700000001);
+    CHECK(Query(folder, options, again, stats));
+    CHECK(stats.filesScanned == 1 && again.size() == 5);
+
+    // Same size, new content: only the mtime tells
+    CHECK(WriteLines(paths[2], { "boot", "sensor FAULT 9", "idle" }));
+    SetMtime(paths[2], 1700000100);
+    CHECK(Query(folder, options, again, stats));
+    CHECK(stats.filesScanned == 1 && again.size() == 5);
+    bool updated = false;
+    for (const QueryMatch& m : again) if (m.text == "sensor FAULT 9") updated = true;
+    CHECK(updated);
+
+    // Without the cache everything is scanned and the cache file is left alone
+    options.useCache = false;
+    CHECK(Query(folder, options, again, stats));
+    CHECK(stats.filesScanned == 4 && again.size() == 5);
+
+    for (const std::string& path : paths) remove(path.c_str());
+    remove(cachePath.c_str());
+    RemoveDir(folder);
+}
+
+int main()
+{
+    TestRegexPrefilter();
+    TestLiteral();
+    TestMultiFile();
+    TestCache();
+    return CheckResult();
+}
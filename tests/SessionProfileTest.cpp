@@ -0,0 +1,146 @@
+// SessionProfileTest.cpp : profile text round trip, parse errors and name rules
+//
+
+#include "SessionProfile.h"
+#include "TestCheck.h"
+
+static bool Parse(const std::string& text, SessionProfile& profile)
+{
+    std::string error;
+    return ParseProfile(text, profile, error);
+}
+
+static bool Rejected(const std::string& text, const char* expect)
+{
+    SessionProfile profile;
+    std::string error;
+    return !ParseProfile(text, profile, error) && error.find(expect) != std::string::npos;
+}
+
+static void TestRoundTrip()
+{
+    SessionProfile p;
+    p.port = "COM7";
+    p.baud = 921600;
+    p.dataBits = 7;
+    p.parity = PAR_EVEN;
+    p.stopBits = STOP_1_5;
+    p.flow = FLOW_RTSCTS;
+    p.dtrReset = false;
+    p.lineEnd = LINE_END_CRLF;
+    p.decoder = DECODER_HEX;
+    HighlightRule error, warn;
+    error.color = 0xFF4040;
+    error.text = "ERROR";
+    warn.color = 0x123abc;
+    warn.text = "low battery = 3.1 V";
+    p.highlights.push_back(error);
+    p.highlights.push_back(warn);
+    p.foldMode = 2;
+    p.logEnabled = false;
+    p.logDir = "D:\\bench\\logs";
+    p.logRotateMb = 64;
+    p.triggers = "text:PANIC; pre:5";
+    p.share = "tcp:7000; lines:7001";
+    p.autoConnect = true;
+
+    SessionProfile q;
+    CHECK(Parse(FormatProfile(p), q));
+    CHECK(q.port == p.port && q.baud == p.baud && q.dataBits == p.dataBits);
+    CHECK(q.parity == p.parity && q.stopBits == p.stopBits && q.flow == p.flow);
+    CHECK(q.dtrReset == p.dtrReset && q.lineEnd == p.lineEnd && q.decoder == p.decoder);
+    CHECK(q.highlights.size() == 2);
+    CHECK(q.highlights.size() == 2 && q.highlights[1].color == 0x123abc && q.highlights[1].text == warn.text);
+    CHECK(q.foldMode == p.foldMode && q.logEnabled == p.logEnabled && q.logDir == p.logDir);
+    CHECK(q.logRotateMb == p.logRotateMb && q.triggers == p.triggers && q.share == p.share);
+    CHECK(q.autoConnect == p.autoConnect);
+    CHECK(FormatProfile(q) == FormatProfile(p));
+
+    // Defaults survive too
+    SessionProfile d;
+    CHECK(Parse(FormatProfile(SessionProfile()), d));
+    CHECK(FormatProfile(d) == FormatProfile(SessionProfile()));
+}
+
+static void TestBomAndCrlf()
+{
+    SessionProfile p;
+    CHECK(Parse("\xEF\xBB\xBF# saved on Windows\r\nport = COM3\r\nbaud = 115200\r\nline_end = CR\r\n\r\n", p));
+    CHECK(p.port == "COM3" && p.baud == 115200 && p.lineEnd == LINE_END_CR);
+    CHECK(p.LineDelimiter() == '\r');
+
+    // Keys are case-insensitive and the last line needs no newline
+    CHECK(Parse("  Parity =\tOdd  \nHIGHLIGHT = yellow warn", p));
+    CHECK(p.parity == PAR_ODD && p.highlights.size() == 1 && p.highlights[0].color == 0xFFFF00);
+    CHECK(p.highlights.size() == 1 && p.highlights[0].text == "warn");
+}
+
+static void TestBadValues()
+{
+    CHECK(Rejected("baud = fast\n", "line 1: bad value for baud"));
+    CHECK(Rejected("baud = 49\n", "bad value for baud"));
+    CHECK(Rejected("baud = 20000001\n", "bad value for baud"));
+    CHECK(Rejected("baud = -9600\n", "bad value for baud"));
+    CHECK(Rejected("baud = 99999999999\n", "bad value for baud"));
+    CHECK(Rejected("baud =\n", "bad value for baud"));
+    CHECK(Rejected("port = COM1\nparity = maybe\n", "line 2: bad value for parity"));
+    CHECK(Rejected("line_end = lfcr\n", "bad value for line_end"));
+    CHECK(Rejected("line_end = \n", "bad value for line_end"));
+    CHECK(Rejected("data_bits = 9\n", "bad value for data_bits"));
+    CHECK(Rejected("highlight = #12345 ERROR\n", "bad value for highlight"));
+    CHECK(Rejected("highlight = red\n", "bad value for highlight"));
+    CHECK(Rejected("dtr_reset = perhaps\n", "bad value for dtr_reset"));
+    CHECK(Rejected("just some text\n", "line 1: expected key = value"));
+
+    // A failed parse leaves the caller's profile untouched
+    SessionProfile p;
+    p.port = "COM9";
+    std::string error;
+    CHECK(!ParseProfile("port = COM1\nbaud = x\n", p, error));
+    CHECK(p.port == "COM9");
+}
+
+static void TestUnknownKeys()
+{
+    CHECK(Rejected("baudrate = 9600\n", "line 1: unknown key 'baudrate'"));
+    CHECK(Rejected("# comment\n\nport = COM1\nLogDir = C:\\x\n", "line 4: unknown key 'logdir'"));
+    CHECK(Rejected("= 5\n", "unknown key ''"));
+}
+
+static void TestNames()
+{
+    CHECK(IsValidProfileName("bench"));
+    CHECK(IsValidProfileName("Bench 2 - motor_test.v1"));
+    CHECK(IsValidProfileName("console"));
+    CHECK(IsValidProfileName("COM10"));
+    CHECK(IsValidProfileName("com0"));
+    CHECK(IsValidProfileName("LPT"));
+    CHECK(IsValidProfileName("nul2"));
+    CHECK(IsValidProfileName(std::string(64, 'a')));
+
+    CHECK(!IsValidProfileName(""));
+    CHECK(!IsValidProfileName(std::string(65, 'a')));
+    CHECK(!IsValidProfileName(".hidden"));
+    CHECK(!IsValidProfileName(" lead"));
+    CHECK(!IsValidProfileName("a/b"));
+    CHECK(!IsValidProfileName("a\\b"));
+    CHECK(!IsValidProfileName("..\\x"));
+    CHECK(!IsValidProfileName("c:x"));
+    CHECK(!IsValidProfileName("what?"));
+
+    // Device names, any case, with or without an extension
+    for (const char* name : { "CON", "con", "Prn", "AUX", "nul", "COM1", "com9", "LPT1", "lpt9",
+                              "con.txt", "NUL.profile", "com3.tar.gz", "aux ", "COM1 .txt" }) {
+        CHECK(!IsValidProfileName(name));
+    }
+}
+
+int main()
+{
+    TestRoundTrip();
+    TestBomAndCrlf();
+    TestBadValues();
+    TestUnknownKeys();
+    TestNames();
+    return CheckResult();
+}
@@ -0,0 +1,76 @@
+// StreamServerBench.cpp : fan-out throughput and writer stalls with many clients
+//
+//   StreamServerBench [clients=64] [megabytes=256] [MB/s=0]
+// Every client reads in its own thread. The publisher pushes 512-byte chunks
+// (a full serial read), unthrottled or at the given rate, and times each
+// PublishRaw call, since the capture thread must never wait on a socket.
+
+#include "TestSockets.h"
+#include "StreamServer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+    int clients = argc > 1 ? atoi(argv[1]) : 64;
+    size_t total = (size_t)(argc > 2 ? atoi(argv[2]) : 256) * 1024 * 1024;
+    double rate = argc > 3 ? atof(argv[3]) * 1024 * 1024 : 0;
+    if (clients < 1 || clients > 200) { fprintf(stderr, "clients must be 1-200\n"); return 2; }
+    SocketsStartup();
+
+    StreamServer server;
+    StreamServerConfig config;
+    config.rawPort = 27450;
+    std::string error;
+    if (!server.Start(config, error)) { fprintf(stderr, "%s\n", error.c_str()); return 1; }
+    std::vector<SOCKET> socks;
+    for (int i = 0; i < clients; i++) socks.push_back(ConnectLocal(config.rawPort));
+    while (server.ClientCount() < (size_t)clients) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+    std::atomic<uint64_t> received{ 0 };
+    std::vector<std::thread> readers;
+    for (int i = 0; i < clients; i++) {
+        readers.emplace_back([&, i] {
+            char buf[65536];
+            int n;
+            while ((n = RecvWithin(socks[i], buf, sizeof(buf), 500)) > 0) received += n;
+        });
+    }
+
+    char chunk[512];
+    for (size_t i = 0; i < sizeof(chunk); i++) chunk[i] = (char)i;
+    std::vector<double> publishUs;
+    publishUs.reserve(total / sizeof(chunk));
+    auto start = std::chrono::steady_clock::now();
+    for (size_t sent = 0; sent < total; sent += sizeof(chunk)) {
+        auto t0 = std::chrono::steady_clock::now();
+        server.PublishRaw(chunk, sizeof(chunk));
+        publishUs.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+        if (rate > 0) {
+            auto due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>((sent + sizeof(chunk)) / rate));
+            while (std::chrono::steady_clock::now() < due) {}
+        }
+    }
+    double publishSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (std::thread& t : readers) t.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() - 0.5;
+
+    std::sort(publishUs.begin(), publishUs.end());
+    double mb = received / (1024.0 * 1024.0);
+    printf("clients %d, published %zu MB in %.2f s\n", clients, total >> 20, publishSeconds);
+    printf("delivered %.0f MB in %.2f s = %.0f MB/s aggregate, skipped %llu MB\n", mb, seconds, mb / seconds,
+        (unsigned long long)(server.SkippedBytes() >> 20));
+    printf("PublishRaw: p50 %.2f us, p99 %.2f us, p99.99 %.1f us, max %.1f us\n",
+        publishUs[publishUs.size() / 2], publishUs[publishUs.size() * 99 / 100],
+        publishUs[publishUs.size() * 9999 / 10000], publishUs.back());
+
+    for (SOCKET s : socks) closesocket(s);
+    server.Stop();
+    SocketsCleanup();
+    return 0;
+}
@@ -0,0 +1,221 @@
+// StreamServerTest.cpp : raw, lines and WebSocket fan-out over loopback
+//
+
+#include "TestSockets.h"
+#include "StreamServer.h"
+#include "TestCheck.h"
+#include <chrono>
+#include <string.h>
+#include <thread>
+
+static const uint16_t BASE_PORT = 27400;
+
+static void SleepMs(int ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+// Publishes 8-byte words that each hold their own stream offset.
+static void PublishPattern(StreamServer& server, uint64_t& seq, size_t total, bool pace = true)
+{
+    uint64_t chunk[64];
+    for (size_t sent = 0; sent < total; sent += sizeof(chunk)) {
+        for (size_t i = 0; i < 64; i++) chunk[i] = seq + i * 8;
+        server.PublishRaw((const char*)chunk, sizeof(chunk));
+        seq += sizeof(chunk);
+        if (pace && (seq & 0xFFFF) == 0) SleepMs(1);
+    }
+}
+
+// Checks a PublishPattern stream. A skip shows up as a forward jump to another
+// word; a torn copy (bytes overwritten while being sent) shows up as a word
+// that is misaligned or goes backwards.
+struct PatternReader {
+    std::string partial;
+    uint64_t next = 0;   // offset the next word should hold
+    size_t bytes = 0, skips = 0, corrupt = 0;
+    uint64_t skipped = 0;
+    void Feed(const char* data, int n)
+    {
+        bytes += n;
+        partial.append(data, n);
+        size_t i = 0;
+        for (; i + 8 <= partial.size(); i += 8) {
+            uint64_t word;
+            memcpy(&word, partial.data() + i, 8);
+            if (word != next) {
+                if (word > next && word % 8 == 0) { skips++; skipped += word - next; }
+                else corrupt++;
+            }
+            next = word + 8;
+        }
+        partial.erase(0, i);
+    }
+};
+
+static void TestRawFanOut()
+{
+    StreamServer server;
+    StreamServerConfig config;
+    config.rawPort = BASE_PORT;
+    std::string error;
+    CHECK(server.Start(config, error));
+    const int clients = 8;
+    SOCKET socks[clients];
+    for (int i = 0; i < clients; i++) socks[i] = ConnectLocal(BASE_PORT);
+    for (int i = 0; i < 100 && server.ClientCount() < (size_t)clients; i++) SleepMs(5);
+    CHECK(server.ClientCount() == (size_t)clients);
+
+    const size_t total = 8 * 1024 * 1024;
+    PatternReader readers[clients];
+    std::thread threads[clients];
+    for (int i = 0; i < clients; i++) {
+        threads[i] = std::thread([&, i] {
+            char buf[65536];
+            int n;
+            while (readers[i].next < total && (n = RecvWithin(socks[i], buf, sizeof(buf), 2000)) > 0) readers[i].Feed(buf, n);
+        });
+    }
+    uint64_t seq = 0;
+    PublishPattern(server, seq, total);
+    for (int i = 0; i < clients; i++) threads[i].join();
+    // Every client ends on the last word, and whatever it missed was a clean skip
+    uint64_t skipped = 0;
+    for (int i = 0; i < clients; i++) {
+        CHECK(readers[i].corrupt == 0);
+        CHECK(readers[i].next == total);
+        CHECK(readers[i].partial.empty());
+        CHECK(readers[i].bytes + readers[i].skipped == total);
+        skipped += readers[i].skipped;
+        closesocket(socks[i]);
+    }
+    CHECK(skipped == server.SkippedBytes());
+    server.Stop();
+}
+
+// A client that stops reading must be skipped ahead, not stall the writer, and
+// what it reads afterwards must be intact apart from the skips.
+static void TestSlowClientSkips()
+{
+    StreamServer server;
+    StreamServerConfig config;
+    config.rawPort = BASE_PORT + 1;
+    config.ringBytes = 256 * 1024;
+    std::string error;
+    CHECK(server.Start(config, error));
+    SOCKET slow = ConnectLocal(BASE_PORT + 1);
+    for (int i = 0; i < 100 && server.ClientCount() < 1; i++) SleepMs(5);
+
+    uint64_t seq = 0;
+    auto start = std::chrono::steady_clock::now();
+    PublishPattern(server, seq, 32 * 1024 * 1024);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    CHECK(seconds < 5.0);
+    SleepMs(50);
+    CHECK(server.SkippedBytes() > 0);
+
+    PatternReader reader;
+    char buf[65536];
+    int n;
+    while ((n = RecvWithin(slow, buf, sizeof(buf), 300)) > 0) reader.Feed(buf, n);
+    CHECK(reader.bytes > 0);
+    CHECK(reader.corrupt == 0);
+    CHECK(reader.next == seq);
+    CHECK(reader.skips > 0 && reader.skipped == server.SkippedBytes());
+    closesocket(slow);
+    server.Stop();
+}
+
+// A reader that keeps reading, but slower than the writer, is lapped over and
+// over while sends are in flight. Every byte it gets must still be intact.
+static void TestLappedReaderIntact()
+{
+    StreamServer server;
+    StreamServerConfig config;
+    config.rawPort = BASE_PORT + 2;
+    config.ringBytes = 64 * 1024;
+    std::string error;
+    CHECK(server.Start(config, error));
+    SOCKET slow = ConnectLocal(BASE_PORT + 2);
+    for (int i = 0; i < 100 && server.ClientCount() < 1; i++) SleepMs(5);
+
+    const size_t total = 16 * 1024 * 1024;
+    PatternReader reader;
+    std::thread thread([&] {
+        char buf[3000];
+        int n;
+        while (reader.next < total && (n = RecvWithin(slow, buf, sizeof(buf), 2000)) > 0) {
+            reader.Feed(buf, n);
+            if (reader.bytes % 65536 < sizeof(buf)) SleepMs(1);
+        }
+    });
+    uint64_t seq = 0;
+    PublishPattern(server, seq, total);
+    thread.join();
+    CHECK(reader.corrupt == 0);
+    CHECK(reader.next == total);
+    CHECK(reader.skips > 10);
+    CHECK(reader.skipped == server.SkippedBytes());
+    CHECK(reader.bytes + reader.skipped == total);
+    closesocket(slow);
+    server.Stop();
+}
+
+static void TestLinesAndWebSocket()
+{
+    StreamServer server;
+    StreamServerConfig config;
+    std::string error;
+    CHECK(ParseShareSpec("lines:27410; ws:27411; write", config, error));
+    CHECK(server.Start(config, error));
+    SOCKET lines = ConnectLocal(27410);
+    SOCKET ws = ConnectLocal(27411);
+    const char* request = "GET /lines HTTP/1.1\r\nHost: x\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    CHECK(SendAll(ws, request, strlen(request)));
+    char buf[4096];
+    int n = RecvWithin(ws, buf, sizeof(buf) - 1, 2000);
+    buf[n] = 0;
+    CHECK(strstr(buf, "101 Switching Protocols") != nullptr);
+    CHECK(strstr(buf, "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=") != nullptr);
+    for (int i = 0; i < 100 && server.ClientCount() < 2; i++) SleepMs(5);
+
+    server.PublishLine(1700000000123ULL, "hello\r\n", 7);
+    n = RecvWithin(lines, buf, sizeof(buf) - 1, 2000);
+    buf[n] = 0;
+    CHECK(n == TIMESTAMP_LEN + 7 && buf[TIMESTAMP_LEN] == '\t' && strcmp(buf + TIMESTAMP_LEN + 1, "hello\n") == 0);
+    n = RecvWithin(ws, buf, sizeof(buf), 2000);
+    CHECK(n == 2 + TIMESTAMP_LEN + 7 && (unsigned char)buf[0] == 0x81 && buf[1] == TIMESTAMP_LEN + 7);
+
+    // Write-through from a masked WebSocket frame and from a lines client
+    const unsigned char frame[] = { 0x81, 0x82, 1, 2, 3, 4, 'A' ^ 1, 'T' ^ 2 };
+    CHECK(SendAll(ws, (const char*)frame, sizeof(frame)));
+    SleepMs(50);
+    CHECK(SendAll(lines, "+\r\n", 3));
+    std::string commands, part;
+    for (int i = 0; i < 100 && commands.size() < 5; i++) {
+        if (server.TakeCommands(part)) commands += part;
+        else SleepMs(5);
+    }
+    CHECK(commands == "AT+\r\n");
+
+    // A close frame is answered before the server drops the connection
+    const unsigned char closeFrame[] = { 0x88, 0x80, 9, 8, 7, 6 };
+    CHECK(SendAll(ws, (const char*)closeFrame, sizeof(closeFrame)));
+    n = RecvWithin(ws, buf, sizeof(buf), 2000);
+    CHECK(n == 2 && (unsigned char)buf[0] == 0x88 && buf[1] == 0);
+    CHECK(RecvWithin(ws, buf, sizeof(buf), 2000) == 0);
+    for (int i = 0; i < 100 && server.ClientCount() > 1; i++) SleepMs(5);
+    CHECK(server.ClientCount() == 1);
+    closesocket(lines);
+    closesocket(ws);
+    server.Stop();
+}
+
+int main()
+{
+    SocketsStartup();
+    TestRawFanOut();
+    TestSlowClientSkips();
+    TestLappedReaderIntact();
+    TestLinesAndWebSocket();
+    SocketsCleanup();
+    return CheckResult();
+}
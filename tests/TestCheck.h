@@ -0,0 +1,21 @@
+// TestCheck.h : minimal check macros shared by the tests
+//
+
+#pragma once
+
+#include <stdio.h>
+
+static int g_checkFailures = 0;
+
+// Records a failure and keeps going, so one run reports every broken check.
+#define CHECK(cond) do { \
+    if (!(cond)) { fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); g_checkFailures++; } \
+} while (0)
+
+// Value of main(): prints a summary and returns non-zero if any check failed.
+inline int CheckResult()
+{
+    if (g_checkFailures) fprintf(stderr, "%d check(s) failed\n", g_checkFailures);
+    else printf("all checks passed\n");
+    return g_checkFailures ? 1 : 0;
+}
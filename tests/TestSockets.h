@@ -0,0 +1,43 @@
+// TestSockets.h : loopback client helpers for the stream server tests and benchmarks
+//
+
+#pragma once
+
+#include "SocketCompat.h"
+
+inline SOCKET ConnectLocal(uint16_t port)
+{
+    SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (s != INVALID_SOCKET && connect(s, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        closesocket(s);
+        s = INVALID_SOCKET;
+    }
+    return s;
+}
+
+// recv() that gives up after timeoutMs. Returns bytes read, 0 on timeout or close.
+inline int RecvWithin(SOCKET s, char* buf, int len, int timeoutMs)
+{
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(s, &readSet);
+    timeval tv = { timeoutMs / 1000, (timeoutMs % 1000) * 1000 };
+    if (select((int)s + 1, &readSet, NULL, NULL, &tv) <= 0) return 0;
+    int n = recv(s, buf, len, 0);
+    return n > 0 ? n : 0;
+}
+
+inline bool SendAll(SOCKET s, const char* data, size_t len)
+{
+    while (len > 0) {
+        int n = send(s, data, (int)len, SEND_FLAGS);
+        if (n <= 0) return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}